@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#include "mapped_file.h"
+
+// The game's art in one file, built ahead of time by snake_packer
+// (packer.cpp) and memory-mapped at startup. Images are stored already
+// decoded and sized, so loading one is handing raylib a pointer into the
+// mapping: no file reads, no PNG decoding and no resizing at launch. Sounds
+// are synthesised (synth.h) and need no assets. Nothing in here depends on
+// raylib.
+//
+// Layout (little-endian):
+//   header   "SNKA", u32 version, u32 entry count, u32 alignment
+//   entries  ASSET_ENTRY_SIZE bytes each:
+//              char name[40]   source path, NUL padded ("Graphics/apple.png")
+//              u32 kind        AssetKind
+//              u32 params[4]   image: width, height, raylib pixel format, mipmaps
+//              u32 reserved
+//              u64 offset, u64 size
+//   data     each entry's bytes, starting on an alignment boundary (a page),
+//            so GPU uploads read whole, aligned pages
+//
+// A pack that is missing, damaged or from another version is ignored and the
+// loose files are loaded instead.
+
+static const uint32_t ASSET_PACK_MAGIC = 0x414B4E53;  // "SNKA"
+static const uint32_t ASSET_PACK_VERSION = 1;
+static const int ASSET_PACK_HEADER_SIZE = 16;
+static const int ASSET_ENTRY_SIZE = 80;
+static const int ASSET_NAME_SIZE = 40;
+static const uint32_t ASSET_ALIGNMENT = 4096;
+
+static const char* const ASSET_PACK_PATH = "assets.pack";
+
+enum AssetKind {
+    // Decoded pixels; params are width, height, format and mipmaps.
+    ASSET_IMAGE = 1
+};
+
+struct AssetEntry {
+    char name[ASSET_NAME_SIZE + 1] = {};
+    uint32_t kind = 0;
+    uint32_t params[4] = {};
+    const uint8_t* data = nullptr;
+    uint64_t size = 0;
+};
+
+class AssetPack {
+public:
+    MappedFile file;
+    uint32_t entryCount = 0;
+
+    bool Open(const char* path) {
+        entryCount = 0;
+        if (!file.Open(path) || file.size < (size_t)ASSET_PACK_HEADER_SIZE) {
+            file.Close();
+            return false;
+        }
+        uint32_t count = (uint32_t)Get(file.data + 8, 4);
+        if (Get(file.data, 4) != ASSET_PACK_MAGIC || Get(file.data + 4, 4) != ASSET_PACK_VERSION ||
+            count > (file.size - ASSET_PACK_HEADER_SIZE) / ASSET_ENTRY_SIZE) {
+            file.Close();
+            return false;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            const uint8_t* entry = EntryAt(i);
+            uint64_t offset = Get(entry + 64, 8);
+            uint64_t size = Get(entry + 72, 8);
+            if (offset > file.size || size > file.size - offset) {
+                file.Close();
+                return false;
+            }
+        }
+        entryCount = count;
+        return true;
+    }
+
+    void Close() {
+        file.Close();
+        entryCount = 0;
+    }
+
+    bool IsOpen() const {
+        return file.IsOpen();
+    }
+
+    // Looks an asset up by the path it was packed from. A linear scan; packs
+    // hold a handful of entries.
+    bool Find(const char* name, AssetEntry& out) const {
+        for (uint32_t i = 0; i < entryCount; i++) {
+            const uint8_t* entry = EntryAt(i);
+            if (strncmp((const char*)entry, name, ASSET_NAME_SIZE) != 0) {
+                continue;
+            }
+            out = AssetEntry();
+            memcpy(out.name, entry, ASSET_NAME_SIZE);
+            out.kind = (uint32_t)Get(entry + 40, 4);
+            for (int p = 0; p < 4; p++) {
+                out.params[p] = (uint32_t)Get(entry + 44 + 4 * p, 4);
+            }
+            out.data = file.data + Get(entry + 64, 8);
+            out.size = Get(entry + 72, 8);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    const uint8_t* EntryAt(uint32_t i) const {
+        return file.data + ASSET_PACK_HEADER_SIZE + (size_t)i * ASSET_ENTRY_SIZE;
+    }
+
+    static uint64_t Get(const uint8_t* data, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= (uint64_t)data[i] << (8 * i);
+        return value;
+    }
+};
+
+// Opened by main before anything is loaded and kept mapped for the whole
+// run; textures are uploaded straight from its pages.
+inline AssetPack assetPack;
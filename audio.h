@@ -1,116 +1,89 @@
 #pragma once
 #include "raylib.h"
 #include "globals.h"
+#include "load_queue.h"
+#include "synth.h"
+#include <atomic>
 
+// Plays the game's sounds through one audio stream whose callback runs the
+// synthesiser (synth.h), so there are no sound files to load. The device is
+// opened on the loader thread (see Load); until it is ready, playing a
+// sound does nothing.
+//
+// Nothing here mixes or touches the device from the main thread: every call
+// just queues a command for the audio thread. Volume, music and score are
+// only sent when they change (see Sync), not every frame.
 class AudioManager {
 public:
-    Sound eatSound;
-    Sound gameOverSound;
-    Sound clickSound;
-    Music backgroundMusic;
-    
-    bool soundsLoaded;
-    bool musicLoaded;
+    AudioStream stream;
+    std::atomic<bool> deviceReady{false};
 
-    AudioManager() {
-        soundsLoaded = false;
-        musicLoaded = false;
-    }
-
-    void Init() {
-        InitAudioDevice();
-        LoadSounds();
-    }
-
-    void LoadSounds() {
-        if (FileExists("Sounds/eat.wav")) {
-            eatSound = LoadSound("Sounds/eat.wav");
-            soundsLoaded = true;
-        }
-        if (FileExists("Sounds/gameover.wav")) {
-            gameOverSound = LoadSound("Sounds/gameover.wav");
-        }
-        if (FileExists("Sounds/click.wav")) {
-            clickSound = LoadSound("Sounds/click.wav");
-        }
-        if (FileExists("Sounds/music.wav")) {
-            backgroundMusic = LoadMusicStream("Sounds/music.wav");
-            musicLoaded = true;
-            UpdateMusicVolume();
-        }
+    // Opening the audio device can take a noticeable fraction of a second,
+    // so it is done off the main thread, ahead of everything else.
+    void Load(LoadQueue& loader) {
+        loader.Submit("audio device", LOAD_CRITICAL, [this]() {
+            InitAudioDevice();
+            if (!IsAudioDeviceReady()) {
+                return;
+            }
+            stream = LoadAudioStream(Synth::SAMPLE_RATE, 16, 1);
+            SetAudioStreamCallback(stream, RenderSynth);
+            PlayAudioStream(stream);
+            deviceReady = true;
+        });
     }
 
     float GetVolumeLevel() {
         return gameSettings.soundVolumeIndex * 0.25f;
     }
 
-    void UpdateMusicVolume() {
-        if (musicLoaded) {
-            SetMusicVolume(backgroundMusic, GetVolumeLevel() * 0.3f);
-        }
-    }
-
     void PlayEatSound() {
-        if (gameSettings.soundVolumeIndex > 0 && soundsLoaded) {
-            SetSoundVolume(eatSound, GetVolumeLevel());
-            PlaySound(eatSound);
-        }
+        Play(EFFECT_EAT);
     }
 
     void PlayGameOverSound() {
-        if (gameSettings.soundVolumeIndex > 0 && soundsLoaded) {
-            SetSoundVolume(gameOverSound, GetVolumeLevel());
-            PlaySound(gameOverSound);
-        }
+        Play(EFFECT_GAME_OVER);
     }
 
     void PlayClickSound() {
-        if (gameSettings.soundVolumeIndex > 0 && soundsLoaded) {
-            SetSoundVolume(clickSound, GetVolumeLevel());
-            PlaySound(clickSound);
-        }
+        Play(EFFECT_CLICK);
     }
 
-    void PlayMusic() {
-        if (gameSettings.soundVolumeIndex > 0 && musicLoaded) {
-            if (!IsMusicStreamPlaying(backgroundMusic)) {
-                PlayMusicStream(backgroundMusic);
-            }
+    // Once a frame: passes on the volume setting and the score (which pitch
+    // and tempo follow), if either changed. Music plays whenever sound is on.
+    void Sync(int score) {
+        if (gameSettings.soundVolumeIndex != sentVolumeIndex) {
+            sentVolumeIndex = gameSettings.soundVolumeIndex;
+            synth.SetVolumes(GetVolumeLevel(), GetVolumeLevel() * 0.3f);
+            synth.SetMusic(sentVolumeIndex > 0);
+        }
+        if (score != sentScore) {
+            sentScore = score;
+            synth.SetScore(score);
         }
     }
 
-    void StopMusic() {
-        if (musicLoaded && IsMusicStreamPlaying(backgroundMusic)) {
-            StopMusicStream(backgroundMusic);
+    // Call after the loader has stopped.
+    void Cleanup() {
+        if (!deviceReady) {
+            return;
         }
+        UnloadAudioStream(stream);
+        CloseAudioDevice();
+        deviceReady = false;
     }
 
-    void UpdateMusic() {
-        if (musicLoaded) {
-            UpdateMusicStream(backgroundMusic);
-            UpdateMusicVolume();
-            
-            if (gameSettings.soundVolumeIndex > 0) {
-                if (!IsMusicStreamPlaying(backgroundMusic)) {
-                    PlayMusicStream(backgroundMusic);
-                }
-            } else {
-                if (IsMusicStreamPlaying(backgroundMusic)) {
-                    StopMusicStream(backgroundMusic);
-                }
-            }
+private:
+    int sentVolumeIndex = -1;
+    int sentScore = -1;
+
+    void Play(SynthEffect effect) {
+        if (gameSettings.soundVolumeIndex > 0 && deviceReady) {
+            synth.Play(effect);
         }
     }
 
-    void Cleanup() {
-        if (soundsLoaded) {
-            UnloadSound(eatSound);
-            UnloadSound(gameOverSound);
-            UnloadSound(clickSound);
-        }
-        if (musicLoaded) {
-            UnloadMusicStream(backgroundMusic);
-        }
-        CloseAudioDevice();
+    static void RenderSynth(void* buffer, unsigned int frames) {
+        synth.Render((int16_t*)buffer, (int)frames);
     }
 };
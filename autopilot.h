@@ -0,0 +1,853 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "simulation.h"
+
+// A Hamiltonian cycle over the board: an order in which to visit every
+// cell, each next to the one before and the last next to the first. Orders
+// are worked out from a formula, so nothing is stored even on the largest
+// boards.
+//
+//   wrap-around   row by row, each row starting one cell further left, so
+//                 the step down from its end wraps onto the next row's start
+//   walls, even   along row 0, back and forth through the other rows, and
+//                 up column 0 to the start
+//   walls, odd    no cycle covers every cell, so it leaves out one corner:
+//                 the hole. The cycle runs (1,0), (1,1), (0,1), and (0,0)
+//                 can take (1,1)'s place there, moving the hole to (1,1);
+//                 Swap does that, so the hole can be visited too
+//
+// Reversed runs the same cycle backwards.
+class BoardCycle {
+public:
+    void Setup(int count, bool walls) {
+        n = count;
+        wallsEnabled = walls;
+        reversed = false;
+        swapped = false;
+    }
+
+    void Orient(bool backwards, bool holeSwapped) {
+        reversed = backwards;
+        swapped = holeSwapped;
+    }
+
+    bool HasHole() const {
+        return wallsEnabled && n % 2 == 1;
+    }
+
+    // The cell the cycle leaves out, or -1.
+    int Hole() const {
+        if (!HasHole()) return -1;
+        return swapped ? n + 1 : 0;
+    }
+
+    // The cell that trades places with the hole on Swap.
+    int Slot() const {
+        return swapped ? 0 : n + 1;
+    }
+
+    void Swap() {
+        swapped = !swapped;
+    }
+
+    int Length() const {
+        return HasHole() ? n * n - 1 : n * n;
+    }
+
+    // Cycle forward from order a to order b.
+    int Distance(int a, int b) const {
+        int d = b - a;
+        return d < 0 ? d + Length() : d;
+    }
+
+    // The cell's place in the cycle, or -1 for the hole.
+    int Order(int cell) const {
+        int order = RawOrder(cell % n, cell / n);
+        if (order < 0 || !reversed) return order;
+        return Length() - 1 - order;
+    }
+
+private:
+    int n = 0;
+    bool wallsEnabled = true;
+    bool reversed = false;
+    bool swapped = false;
+
+    int RawOrder(int x, int y) const {
+        if (!wallsEnabled) {
+            return y * n + (x + y) % n;
+        }
+        if (n % 2 == 0) {
+            if (y == 0) return x;
+            if (x == 0) return n + (n - 1) * (n - 1) + (n - 1 - y);
+            int base = n + (y - 1) * (n - 1);
+            return base + (y % 2 == 1 ? n - 1 - x : x - 1);
+        }
+        // Rows n-1 down to 3 back and forth over columns 1..n-1, then (1,2),
+        // rows 1 and 2 zigzagging over columns 2..n-1, row 0 leftwards, the
+        // slot and column 0 downwards.
+        int rows = (n - 3) * (n - 1);
+        int zigzag = rows + 1 + 2 * (n - 2);
+        if (y >= 3 && x >= 1) {
+            int k = n - 1 - y;
+            return k * (n - 1) + (k % 2 == 0 ? x - 1 : n - 1 - x);
+        }
+        if (x == 1 && y == 2) return rows;
+        if (x >= 2 && (y == 1 || y == 2)) {
+            bool downFirst = x % 2 == 0;
+            return rows + 1 + 2 * (x - 2) + ((y == 2) == downFirst ? 0 : 1);
+        }
+        if (y == 0 && x >= 1) return zigzag + (n - 1 - x);
+        if ((x == 1 && y == 1) || (x == 0 && y == 0)) {
+            return (x == 0) == swapped ? zigzag + n - 1 : -1;
+        }
+        return zigzag + n + (y - 1);
+    }
+};
+
+// Plays the game on its own. It heads for the apple along a shortest path,
+// but only when the snake could still reach its own tail after eating there;
+// otherwise it follows its tail, taking the long way round, until the apple
+// is safe to go for. Keeping the tail in reach is what lets it fill most of a
+// board, but not all: late on, that check can still box the snake in.
+//
+// So whenever the body lies along a BoardCycle in order, tail to head, as it
+// does at the start of every game, it switches to touring that cycle for
+// the rest of the game. Following the cycle fills the board; while the
+// board is less than half full it takes shortcuts towards the apple, but
+// never so far that it would pass its tail. Walled boards with an odd side
+// are the exception: no cycle covers them, and filling the last cell there
+// depends on where the last two apples land, so the tour only gets to the
+// last apple every time and eats it when they fall right.
+//
+// Distances to the apple are kept in a field over the whole board that is
+// updated as the snake moves instead of being searched again every tick. A
+// freed tail cell can only shorten distances, so new ones spread out from
+// it. A new head cell can only lengthen them, so the cells whose shortest
+// path ran through it are collected and settled again from their
+// neighbours. The field is only rebuilt when the apple moves.
+//
+// Each call does at most workBudget units of work (one per cell visited),
+// counted rather than timed so games stay reproducible. Half goes to
+// keeping the field current and the rest to choosing a move. A rebuild that
+// does not fit, as on huge boards, carries on over the next ticks. Until it
+// is done the autopilot steers straight for the apple, with the same
+// tail check.
+class Autopilot {
+public:
+    static constexpr int UNREACHED = INT_MAX;
+
+    int workBudget = 50000;
+
+    // Forgets the current game; the next Choose starts from scratch.
+    void Reset() {
+        synced = false;
+        touring = false;
+    }
+
+    // The input for the next tick. Call once per tick, before Step.
+    Direction Choose(const Simulation& sim) {
+        work = 0;
+        if (Touring(sim)) {
+            Direction dir = Tour(sim);
+            if (dir != DIR_NONE) {
+                return dir;
+            }
+            touring = false;
+        }
+        Sync(sim);
+        Advance(sim, workBudget / 2);
+
+        struct Candidate {
+            Direction dir;
+            int cell;
+            long long order;
+            int area;
+        };
+        Candidate candidates[4];
+        int count = 0;
+        for (Direction dir : DIRECTIONS) {
+            Cell next;
+            if (!sim.CanTurn(dir) || !sim.IsSafeMove(dir) || !sim.NextCell(dir, next)) {
+                continue;
+            }
+            int cell = sim.CellIndex(next);
+            // Distance in the field first, then as the crow flies (which
+            // is all there is while the field is being rebuilt).
+            long long order = Manhattan(next, sim.apple);
+            if (phase == READY) order += (long long)distance[cell] * 16384;
+            // Insertion sort, nearest to the apple first.
+            int slot = count++;
+            while (slot > 0 && candidates[slot - 1].order > order) {
+                candidates[slot] = candidates[slot - 1];
+                slot--;
+            }
+            candidates[slot] = Candidate{dir, cell, order, 0};
+        }
+        if (count == 0) {
+            return sim.direction;
+        }
+
+        if (sim.score != lastScore) {
+            lastScore = sim.score;
+            lastMeal = sim.tick;
+        }
+        // Chasing the tail can settle into a loop the apple never becomes
+        // safe from. After a board's worth of moves without eating, settle
+        // for the one-move check on the way to the apple; after several,
+        // just go for it, so a demo never circles forever.
+        uint64_t hungry = sim.tick - lastMeal;
+        uint64_t cells = (uint64_t)cellCount * cellCount;
+        bool stalled = hungry > cells;
+        bool desperate = hungry > 4 * cells;
+
+        if (phase == READY) {
+            if (distance[candidates[0].cell] != UNREACHED) {
+                int area = 0;
+                bool safe = desperate || (stalled ? StepReach(sim, candidates[0].cell, FloodCap(sim, count), area) > 0
+                                                  : PathIsSafe(sim, candidates[0].cell));
+                if (safe) {
+                    return candidates[0].dir;
+                }
+            }
+            // Follow the tail the long way round, to make room. Stalled,
+            // take any safe move at random instead, to reshape the body.
+            int chase = -1;
+            int chaseReach = 0;
+            Rng shake(sim.config.seed ^ sim.tick);
+            for (int i = 0; i < count; i++) {
+                int reach = StepReach(sim, candidates[i].cell, FloodCap(sim, count), candidates[i].area);
+                if (stalled && reach > 0) reach = 1 + shake.Below(1000);
+                if (reach > 0 && reach >= chaseReach) {
+                    chase = i;
+                    chaseReach = reach;
+                }
+            }
+            if (chase >= 0) {
+                return candidates[chase].dir;
+            }
+        } else {
+            for (int i = 0; i < count; i++) {
+                if (StepReach(sim, candidates[i].cell, FloodCap(sim, count), candidates[i].area) > 0) {
+                    return candidates[i].dir;
+                }
+            }
+        }
+
+        // Cut off from the tail whatever we do: take the most room.
+        int best = 0;
+        for (int i = 1; i < count; i++) {
+            if (candidates[i].area > candidates[best].area) best = i;
+        }
+        return candidates[best].dir;
+    }
+
+private:
+    enum Phase { COPY, SEARCH, READY };
+
+    struct Change {
+        int cell;
+        bool blocked;
+    };
+
+    static constexpr Direction DIRECTIONS[] = {DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT};
+
+    BoardCycle cycle;
+    bool touring = false;
+    int tourCellCount = 0;
+    bool tourWalls = true;
+    uint64_t tourSeed = 0;
+    uint64_t tourTick = 0;
+
+    bool synced = false;
+    int cellCount = 0;
+    bool wallsEnabled = true;
+    uint64_t seed = 0;
+    uint64_t tick = 0;
+    int appleCell = -1;
+    int lastScore = 0;
+    uint64_t lastMeal = 0;
+
+    // The field's own view of which cells the body covers. While a rebuild
+    // runs it stays as it was when the rebuild started, and moves are kept
+    // in pending to be applied once the search is done.
+    std::vector<uint8_t> blocked;
+    std::vector<int> distance;
+    std::vector<Change> pending;
+
+    Phase phase = COPY;
+    int copyCursor = 0;
+    std::vector<int> frontier;
+    size_t frontierHead = 0;
+
+    // Scratch marks for one update or check at a time: a cell is marked
+    // when its stamp equals the current value.
+    std::vector<uint32_t> stamps;
+    uint32_t stamp = 0;
+    std::vector<int> scratch;
+    std::vector<int> route;
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>,
+                        std::greater<std::pair<int, int>>> settle;
+
+    int work = 0;
+
+    // True while the game is the one being toured, tick after tick; if not,
+    // tries to start touring it.
+    bool Touring(const Simulation& sim) {
+        bool sameGame = touring && sim.config.cellCount == tourCellCount &&
+                        sim.config.wallsEnabled == tourWalls && sim.config.seed == tourSeed &&
+                        (sim.tick == tourTick || sim.tick == tourTick + 1);
+        if (!sameGame) {
+            touring = false;
+            // The order check walks the whole body, so only short ones are
+            // tried every tick.
+            if (sim.body.Size() > workBudget / 8) {
+                return false;
+            }
+            cycle.Setup(sim.config.cellCount, sim.config.wallsEnabled);
+            for (int variant = 0; variant < 4 && !touring; variant++) {
+                if (variant >= 2 && !cycle.HasHole()) break;
+                cycle.Orient(variant % 2 == 1, variant >= 2);
+                touring = InCycleOrder(sim);
+            }
+            if (!touring) {
+                return false;
+            }
+            tourCellCount = sim.config.cellCount;
+            tourWalls = sim.config.wallsEnabled;
+            tourSeed = sim.config.seed;
+        }
+        tourTick = sim.tick;
+        return true;
+    }
+
+    // Whether every body cell is on the cycle and they come in cycle order
+    // from tail to head, leaving room ahead of the head to grow into. Once
+    // that holds, Tour keeps it holding.
+    bool InCycleOrder(const Simulation& sim) const {
+        int length = sim.body.Size();
+        int previous = cycle.Order(sim.body.IndexAt(length - 1));
+        if (previous < 0) {
+            return false;
+        }
+        long long span = 0;
+        for (int i = length - 2; i >= 0; i--) {
+            int order = cycle.Order(sim.body.IndexAt(i));
+            if (order < 0 || order == previous) {
+                return false;
+            }
+            span += cycle.Distance(previous, order);
+            previous = order;
+        }
+        return cycle.Length() - span > 2 + (sim.growPending ? 1 : 0);
+    }
+
+    // The next move along the cycle, cutting ahead towards the apple while
+    // there is room to. DIR_NONE if no move keeps to the cycle, which the
+    // order invariant rules out.
+    Direction Tour(const Simulation& sim) {
+        int head = sim.body.IndexAt(0);
+        int tail = sim.body.IndexAt(sim.body.Size() - 1);
+        int apple = sim.CellIndex(sim.apple);
+        int headOrder = cycle.Order(head);
+        int growth = sim.growPending ? 1 : 0;
+
+        // An apple in the hole is reached by swapping it into the cycle just
+        // as the head gets to the slot, which must be free (or the tail,
+        // about to move off) so the body stays on the new cycle.
+        int target;
+        if (apple == cycle.Hole()) {
+            int slot = cycle.Slot();
+            target = (cycle.Order(slot) + cycle.Length() - 1) % cycle.Length();
+            if (headOrder == target && (!sim.occupied[slot] || (slot == tail && !growth))) {
+                Direction dir = DirectionTo(sim, apple);
+                if (dir != DIR_NONE) {
+                    cycle.Swap();
+                    return dir;
+                }
+            }
+        } else {
+            target = cycle.Order(apple);
+        }
+
+        // How far ahead along the cycle a move may land. Staying a few cells
+        // short of the tail leaves room to grow; past half full, shortcuts
+        // would leave gaps the snake has to come back round for, so it just
+        // follows the cycle.
+        int toTail = cycle.Distance(headOrder, cycle.Order(tail));
+        int toFood = cycle.Distance(headOrder, target);
+        long long cells = (long long)cycle.Length();
+        long long empty = cells - sim.body.Size() - growth - 1;
+        int cut = toTail - growth - 3;
+        if (empty < cells / 2) {
+            cut = 0;
+        } else if (toFood < toTail) {
+            cut -= 1;
+            if ((long long)(toTail - toFood) * 4 > empty) cut -= 10;
+        }
+        if (cut > toFood) cut = toFood;
+
+        Direction best = DIR_NONE;
+        int bestAhead = 0;
+        for (Direction dir : DIRECTIONS) {
+            Cell next;
+            if (!sim.CanTurn(dir) || !sim.IsSafeMove(dir) || !sim.NextCell(dir, next)) {
+                continue;
+            }
+            int order = cycle.Order(sim.CellIndex(next));
+            if (order < 0) {
+                continue;
+            }
+            int ahead = cycle.Distance(headOrder, order);
+            if ((ahead == 1 || ahead <= cut) && ahead > bestAhead) {
+                best = dir;
+                bestAhead = ahead;
+            }
+        }
+        return best;
+    }
+
+    Direction DirectionTo(const Simulation& sim, int cell) const {
+        for (Direction dir : DIRECTIONS) {
+            Cell next;
+            if (sim.CanTurn(dir) && sim.IsSafeMove(dir) && sim.NextCell(dir, next) && sim.CellIndex(next) == cell) {
+                return dir;
+            }
+        }
+        return DIR_NONE;
+    }
+
+    int Neighbours(int cell, int out[4]) const {
+        int n = cellCount;
+        int x = cell % n;
+        int y = cell / n;
+        int count = 0;
+        if (wallsEnabled) {
+            if (y > 0) out[count++] = cell - n;
+            if (y < n - 1) out[count++] = cell + n;
+            if (x > 0) out[count++] = cell - 1;
+            if (x < n - 1) out[count++] = cell + 1;
+        } else {
+            out[count++] = y > 0 ? cell - n : cell + n * (n - 1);
+            out[count++] = y < n - 1 ? cell + n : x;
+            out[count++] = x > 0 ? cell - 1 : cell + n - 1;
+            out[count++] = x < n - 1 ? cell + 1 : cell - n + 1;
+        }
+        return count;
+    }
+
+    long long Manhattan(Cell a, Cell b) const {
+        int dx = abs(a.x - b.x);
+        int dy = abs(a.y - b.y);
+        if (!wallsEnabled) {
+            if (cellCount - dx < dx) dx = cellCount - dx;
+            if (cellCount - dy < dy) dy = cellCount - dy;
+        }
+        return dx + dy;
+    }
+
+    // Returns a fresh stamp value; count values are reserved after it.
+    uint32_t NextStamp(int count) {
+        if (stamp > UINT32_MAX - 8) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            stamp = 0;
+        }
+        uint32_t first = stamp + 1;
+        stamp += count;
+        return first;
+    }
+
+    // How far a tail check may flood. Open room several times the snake's
+    // length counts as safe without finding the tail, which keeps checks
+    // on big, mostly empty boards short.
+    int FloodCap(const Simulation& sim, int candidates) const {
+        long long room = 4LL * sim.body.Size() + 64;
+        int cap = (workBudget - work) / candidates;
+        if (cap > room) cap = (int)room;
+        return cap < 64 ? 64 : cap;
+    }
+
+    // Works out what changed since the last call: one step (fold it into
+    // the field), or anything else (start over).
+    void Sync(const Simulation& sim) {
+        bool sameGame = synced && sim.config.cellCount == cellCount &&
+                        sim.config.wallsEnabled == wallsEnabled && sim.config.seed == seed;
+        if (!sameGame || (sim.tick != tick && sim.tick != tick + 1)) {
+            Start(sim);
+            return;
+        }
+        if (sim.tick == tick) {
+            return;
+        }
+        tick = sim.tick;
+
+        int apple = sim.CellIndex(sim.apple);
+        if (apple != appleCell) {
+            appleCell = apple;
+            BeginRebuild();
+        }
+        if (sim.moved) {
+            if (sim.vacatedTail >= 0) Apply(Change{sim.vacatedTail, false});
+            Apply(Change{sim.body.IndexAt(0), true});
+        }
+    }
+
+    void Start(const Simulation& sim) {
+        cellCount = sim.config.cellCount;
+        wallsEnabled = sim.config.wallsEnabled;
+        seed = sim.config.seed;
+        tick = sim.tick;
+        appleCell = sim.CellIndex(sim.apple);
+        lastScore = sim.score;
+        lastMeal = sim.tick;
+        size_t total = (size_t)cellCount * cellCount;
+        if (blocked.size() != total) {
+            blocked.assign(total, 0);
+            distance.assign(total, UNREACHED);
+            stamps.assign(total, 0);
+            stamp = 0;
+        }
+        synced = true;
+        BeginRebuild();
+    }
+
+    void BeginRebuild() {
+        phase = COPY;
+        copyCursor = 0;
+        pending.clear();
+    }
+
+    void BeginSearch() {
+        phase = SEARCH;
+        frontier.clear();
+        frontierHead = 0;
+        if (!blocked[appleCell]) {
+            distance[appleCell] = 0;
+            frontier.push_back(appleCell);
+        }
+    }
+
+    // Steps a rebuild along until work reaches limit. The copy reads the
+    // live board, which is safe because every pending change is replayed
+    // once the search is done, and each one sets a cell's state outright.
+    void Advance(const Simulation& sim, int limit) {
+        int total = cellCount * cellCount;
+        while (phase != READY && work < limit) {
+            if (phase == COPY) {
+                int end = copyCursor + (limit - work);
+                if (end > total) end = total;
+                for (int cell = copyCursor; cell < end; cell++) {
+                    blocked[cell] = sim.occupied[cell];
+                    distance[cell] = UNREACHED;
+                }
+                work += end - copyCursor;
+                copyCursor = end;
+                if (copyCursor == total) {
+                    BeginSearch();
+                }
+            } else if (frontierHead == frontier.size()) {
+                phase = READY;
+                ApplyPending();
+            } else {
+                int cell = frontier[frontierHead++];
+                int next = distance[cell] + 1;
+                int neighbours[4];
+                int count = Neighbours(cell, neighbours);
+                for (int i = 0; i < count; i++) {
+                    int v = neighbours[i];
+                    if (!blocked[v] && distance[v] == UNREACHED) {
+                        distance[v] = next;
+                        frontier.push_back(v);
+                    }
+                }
+                work++;
+            }
+        }
+    }
+
+    void ApplyPending() {
+        std::vector<Change> changes;
+        changes.swap(pending);
+        for (const Change& change : changes) {
+            Apply(change);
+        }
+    }
+
+    void Apply(const Change& change) {
+        if (phase != READY) {
+            pending.push_back(change);
+            return;
+        }
+        bool done = change.blocked ? Block(change.cell) : Free(change.cell);
+        if (!done) {
+            // Too much of the field moved: rebuild it over the next ticks.
+            BeginRebuild();
+        }
+    }
+
+    // A cell left by the tail. Distances can only shrink, so they spread
+    // out from it breadth first. Returns false if that overran the budget.
+    bool Free(int cell) {
+        if (!blocked[cell]) {
+            return true;
+        }
+        blocked[cell] = 0;
+        int neighbours[4];
+        int best = UNREACHED;
+        if (cell == appleCell) {
+            best = 0;
+        } else {
+            int count = Neighbours(cell, neighbours);
+            for (int i = 0; i < count; i++) {
+                int d = distance[neighbours[i]];
+                if (!blocked[neighbours[i]] && d != UNREACHED && d + 1 < best) best = d + 1;
+            }
+        }
+        distance[cell] = best;
+        if (best == UNREACHED) {
+            return true;
+        }
+
+        scratch.clear();
+        scratch.push_back(cell);
+        for (size_t head = 0; head < scratch.size(); head++) {
+            int u = scratch[head];
+            int next = distance[u] + 1;
+            int count = Neighbours(u, neighbours);
+            for (int i = 0; i < count; i++) {
+                int v = neighbours[i];
+                if (!blocked[v] && distance[v] > next) {
+                    distance[v] = next;
+                    scratch.push_back(v);
+                }
+            }
+            if (++work > workBudget / 2) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A cell taken by the head. Cells that only had a shortest path through
+    // it are found level by level; since levels are visited in order, a
+    // cell's other parents have all been judged by the time it is. Those
+    // cells then get the best distance their unaffected neighbours offer,
+    // which spreads among them shortest first.
+    bool Block(int cell) {
+        if (blocked[cell]) {
+            return true;
+        }
+        blocked[cell] = 1;
+        int old = distance[cell];
+        distance[cell] = UNREACHED;
+        if (old == UNREACHED) {
+            return true;
+        }
+
+        uint32_t mark = NextStamp(1);
+        stamps[cell] = mark;
+        scratch.clear();
+        scratch.push_back(cell);
+        int neighbours[4];
+        int parents[4];
+        // The levels of cells in scratch are old + their depth; track the
+        // depth boundary to know each cell's old level.
+        size_t levelEnd = 1;
+        int level = old;
+        for (size_t head = 0; head < scratch.size(); head++) {
+            if (head == levelEnd) {
+                levelEnd = scratch.size();
+                level++;
+            }
+            int u = scratch[head];
+            int count = Neighbours(u, neighbours);
+            for (int i = 0; i < count; i++) {
+                int v = neighbours[i];
+                if (blocked[v] || stamps[v] == mark || distance[v] != level + 1) {
+                    continue;
+                }
+                bool otherParent = false;
+                int parentCount = Neighbours(v, parents);
+                for (int j = 0; j < parentCount && !otherParent; j++) {
+                    int w = parents[j];
+                    otherParent = !blocked[w] && stamps[w] != mark && distance[w] == level;
+                }
+                if (!otherParent) {
+                    stamps[v] = mark;
+                    scratch.push_back(v);
+                }
+            }
+            if (++work > workBudget / 2) {
+                return false;
+            }
+        }
+
+        while (!settle.empty()) settle.pop();
+        for (size_t i = 1; i < scratch.size(); i++) {
+            int v = scratch[i];
+            int best = UNREACHED;
+            int count = Neighbours(v, neighbours);
+            for (int j = 0; j < count; j++) {
+                int w = neighbours[j];
+                if (!blocked[w] && stamps[w] != mark && distance[w] != UNREACHED && distance[w] + 1 < best) {
+                    best = distance[w] + 1;
+                }
+            }
+            distance[v] = best;
+            if (best != UNREACHED) {
+                settle.push(std::make_pair(best, v));
+            }
+        }
+        while (!settle.empty()) {
+            std::pair<int, int> top = settle.top();
+            settle.pop();
+            if (top.first != distance[top.second]) {
+                continue;
+            }
+            int next = top.first + 1;
+            int count = Neighbours(top.second, neighbours);
+            for (int i = 0; i < count; i++) {
+                int v = neighbours[i];
+                if (stamps[v] == mark && !blocked[v] && distance[v] > next) {
+                    distance[v] = next;
+                    settle.push(std::make_pair(next, v));
+                }
+            }
+            if (++work > workBudget / 2) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Would the snake still reach its tail after following the field all
+    // the way to the apple from first? At that point the body is the end of
+    // the path, plus whatever of the old body it has not yet pulled out of.
+    bool PathIsSafe(const Simulation& sim, int first) {
+        int length = sim.body.Size();
+        int steps = distance[first] + 1;
+        int area = 0;
+        if (steps + length > workBudget - work) {
+            return StepReach(sim, first, FloodCap(sim, 1), area) > 0;
+        }
+
+        route.clear();
+        int neighbours[4];
+        int cell = first;
+        route.push_back(cell);
+        while (distance[cell] > 0) {
+            int count = Neighbours(cell, neighbours);
+            int next = -1;
+            for (int i = 0; i < count && next < 0; i++) {
+                int v = neighbours[i];
+                if (!blocked[v] && distance[v] == distance[cell] - 1) next = v;
+            }
+            if (next < 0) {
+                return false;
+            }
+            cell = next;
+            route.push_back(cell);
+        }
+
+        uint32_t body = NextStamp(3);
+        uint32_t freed = body + 1;
+        int keep = length + (sim.growPending ? 1 : 0);
+        int tail;
+        if (keep <= steps) {
+            for (int i = 0; i < length; i++) {
+                stamps[sim.body.IndexAt(i)] = freed;
+            }
+            for (int i = steps - keep; i < steps; i++) {
+                stamps[route[i]] = body;
+            }
+            tail = route[steps - keep];
+        } else {
+            for (int cell : route) {
+                stamps[cell] = body;
+            }
+            for (int i = keep - steps; i < length; i++) {
+                stamps[sim.body.IndexAt(i)] = freed;
+            }
+            tail = sim.body.IndexAt(keep - steps - 1);
+        }
+        work += steps + length;
+        // Having just eaten, the tail stays put for one more move.
+        return Reach(sim, route.back(), tail, false, body, FloodCap(sim, 1), area) > 0;
+    }
+
+    // How many moves the head would need to get onto the tail after moving
+    // to first, or -1 if it could not. area is how much room it found.
+    int StepReach(const Simulation& sim, int first, int cap, int& area) {
+        int length = sim.body.Size();
+        uint32_t body = NextStamp(3);
+        stamps[first] = body;
+        int tail = sim.body.IndexAt(length - 1);
+        if (!sim.growPending) {
+            stamps[tail] = body + 1;
+            tail = sim.body.IndexAt(length - 2);
+        }
+        // Eating on first holds the tail still for the move after.
+        bool eats = first == sim.CellIndex(sim.apple);
+        return Reach(sim, first, tail, !eats, body, cap, area);
+    }
+
+    // Breadth-first flood from head over cells that are free in the
+    // imagined body (marks from bodyStamp: +0 covered, +1 freed, +2
+    // visited). Returns the moves needed to get onto the tail, or -1. A
+    // flood that finds cap cells stops there and counts as reaching it:
+    // that is room enough to be safe.
+    int Reach(const Simulation& sim, int head, int tail, bool tailMoves, uint32_t bodyStamp, int cap, int& area) {
+        uint32_t freed = bodyStamp + 1;
+        uint32_t visited = bodyStamp + 2;
+        int neighbours[4];
+        area = 0;
+        scratch.clear();
+        int count = Neighbours(head, neighbours);
+        for (int i = 0; i < count; i++) {
+            int v = neighbours[i];
+            if (v == tail && tailMoves) {
+                return 1;
+            }
+            uint32_t s = stamps[v];
+            if (s != bodyStamp && s != visited && (s == freed || !sim.occupied[v])) {
+                stamps[v] = visited;
+                scratch.push_back(v);
+            }
+        }
+        size_t levelEnd = scratch.size();
+        int depth = 1;
+        for (size_t next = 0; next < scratch.size(); next++) {
+            if (next == levelEnd) {
+                levelEnd = scratch.size();
+                depth++;
+            }
+            int u = scratch[next];
+            area++;
+            work++;
+            count = Neighbours(u, neighbours);
+            for (int i = 0; i < count; i++) {
+                if (neighbours[i] == tail) return depth + 1;
+            }
+            if (area >= cap) {
+                return depth + 1;
+            }
+            for (int i = 0; i < count; i++) {
+                int v = neighbours[i];
+                uint32_t s = stamps[v];
+                if (s != bodyStamp && s != visited && (s == freed || !sim.occupied[v])) {
+                    stamps[v] = visited;
+                    scratch.push_back(v);
+                }
+            }
+        }
+        return -1;
+    }
+};
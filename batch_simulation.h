@@ -0,0 +1,380 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "simulation.h"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+// Runs many independent games in lockstep. Per-game scalars live in
+// struct-of-arrays form so head movement, wall/wrap handling and food checks
+// can be done for a whole lane of games at once (AVX2, SSE4.1, or a scalar
+// fallback). Bodies, occupancy and free cells are stored in flat per-game
+// slabs and follow exactly the same rules as Simulation: the same seed and
+// actions give the same game.
+class BatchSimulation {
+public:
+    // Bodies keep 16-bit cell indices, so boards go up to 256x256.
+    static const int MAX_CELLS = 65536;
+
+    int gameCount = 0;
+    int cellCount = 0;
+    int cellTotal = 0;
+    bool wallsEnabled = true;
+
+    // Hot per-game state, one entry per game.
+    std::vector<int32_t> headX;
+    std::vector<int32_t> headY;
+    std::vector<int32_t> dirX;
+    std::vector<int32_t> dirY;
+    std::vector<int32_t> appleIndex;
+    std::vector<int32_t> length;
+    std::vector<int32_t> score;
+    std::vector<int32_t> alive;
+    std::vector<int32_t> won;
+    std::vector<int32_t> growPending;
+
+    // Results of the vector phase, consumed by the per-game phase.
+    std::vector<int32_t> nextIndex;
+    std::vector<int32_t> hitWall;
+    std::vector<int32_t> ate;
+
+    // Per-game slabs of cellTotal entries each.
+    std::vector<uint16_t> bodies;
+    std::vector<int32_t> bodyFirst;
+    std::vector<uint8_t> occupied;
+    std::vector<int32_t> freeCells;
+    std::vector<int32_t> freeSlots;
+    std::vector<int32_t> freeCount;
+    std::vector<Rng> rngs;
+
+    void Init(int games, int cells, bool walls) {
+        gameCount = games;
+        cellCount = cells;
+        cellTotal = cells * cells;
+        wallsEnabled = walls;
+
+        size_t n = (size_t)games;
+        size_t slab = n * (size_t)cellTotal;
+        for (std::vector<int32_t>* column : {&headX, &headY, &dirX, &dirY, &appleIndex, &length, &score,
+                                             &alive, &won, &growPending, &nextIndex, &hitWall, &ate,
+                                             &bodyFirst, &freeCount}) {
+            column->assign(n, 0);
+        }
+        bodies.assign(slab, 0);
+        occupied.assign(slab, 0);
+        freeCells.assign(slab, 0);
+        freeSlots.assign(slab, 0);
+        rngs.assign(n, Rng());
+    }
+
+    void Reset(uint64_t seed) {
+        Rng seeds(seed);
+        for (int g = 0; g < gameCount; g++) {
+            ResetGame(g, seeds.Next());
+        }
+    }
+
+    void ResetGame(int g, uint64_t seed) {
+        rngs[g].Seed(seed);
+        uint8_t* occ = &occupied[(size_t)g * cellTotal];
+        int32_t* cells = &freeCells[(size_t)g * cellTotal];
+        int32_t* slots = &freeSlots[(size_t)g * cellTotal];
+        for (int i = 0; i < cellTotal; i++) {
+            occ[i] = 0;
+            cells[i] = i;
+            slots[i] = i;
+        }
+        freeCount[g] = cellTotal;
+        bodyFirst[g] = 0;
+        length[g] = 0;
+
+        int startX = cellCount / 4;
+        int startY = cellCount / 2;
+        for (int i = 0; i < 3; i++) {
+            int index = startY * cellCount + startX + i;
+            PushFront(g, index);
+            occ[index] = 1;
+            RemoveFree(g, index);
+        }
+        headX[g] = startX + 2;
+        headY[g] = startY;
+        dirX[g] = 1;
+        dirY[g] = 0;
+        growPending[g] = 0;
+        alive[g] = 1;
+        won[g] = 0;
+        score[g] = 0;
+        appleIndex[g] = PickFree(g);
+    }
+
+    // Advances every live game by one tick. actions holds one Direction per
+    // game; DIR_NONE or a reversal keeps the current heading.
+    void StepBatch(const int32_t* actions) {
+        StepRange(actions, 0, gameCount);
+    }
+
+    // Steps games [begin, end). Disjoint ranges touch disjoint memory, so
+    // callers may split a batch across threads.
+    void StepRange(const int32_t* actions, int begin, int end) {
+        int g = begin;
+#if defined(__AVX2__)
+        for (; g + 8 <= end; g += 8) {
+            MoveHeadsAvx2(actions, g);
+        }
+#elif defined(__SSE4_1__)
+        for (; g + 4 <= end; g += 4) {
+            MoveHeadsSse41(actions, g);
+        }
+#endif
+        for (; g < end; g++) {
+            MoveHeadScalar(actions, g);
+        }
+
+        for (g = begin; g < end; g++) {
+            if (alive[g]) {
+                FinishStep(g);
+            }
+        }
+    }
+
+    int BodyIndexAt(int g, int position) const {
+        int slot = bodyFirst[g] + position;
+        if (slot >= cellTotal) slot -= cellTotal;
+        return bodies[(size_t)g * cellTotal + slot];
+    }
+
+private:
+    void MoveHeadScalar(const int32_t* actions, int g) {
+        int action = actions[g];
+        int dx = (action == DIR_RIGHT) - (action == DIR_LEFT);
+        int dy = (action == DIR_DOWN) - (action == DIR_UP);
+        bool reverse = dx == -dirX[g] && dy == -dirY[g];
+        if (action != DIR_NONE && !reverse && alive[g]) {
+            dirX[g] = dx;
+            dirY[g] = dy;
+        }
+
+        int x = headX[g] + dirX[g];
+        int y = headY[g] + dirY[g];
+        bool outside = x < 0 || x >= cellCount || y < 0 || y >= cellCount;
+        if (!wallsEnabled) {
+            if (x >= cellCount) x = 0;
+            else if (x < 0) x = cellCount - 1;
+            if (y >= cellCount) y = 0;
+            else if (y < 0) y = cellCount - 1;
+        }
+        bool wall = wallsEnabled && outside;
+        int index = wall ? 0 : y * cellCount + x;
+        hitWall[g] = wall;
+        nextIndex[g] = index;
+        ate[g] = !wall && index == appleIndex[g];
+        if (!wall && alive[g]) {
+            headX[g] = x;
+            headY[g] = y;
+        }
+    }
+
+#if defined(__AVX2__)
+    void MoveHeadsAvx2(const int32_t* actions, int g) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i n = _mm256_set1_epi32(cellCount);
+        const __m256i last = _mm256_set1_epi32(cellCount - 1);
+
+        __m256i action = _mm256_loadu_si256((const __m256i*)(actions + g));
+        __m256i live = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)&alive[g]), zero);
+        __m256i curX = _mm256_loadu_si256((const __m256i*)&dirX[g]);
+        __m256i curY = _mm256_loadu_si256((const __m256i*)&dirY[g]);
+
+        // Compare masks are -1 where true, so LEFT - RIGHT yields the -1/0/+1 step.
+        __m256i dx = _mm256_sub_epi32(_mm256_cmpeq_epi32(action, _mm256_set1_epi32(DIR_LEFT)),
+                                      _mm256_cmpeq_epi32(action, _mm256_set1_epi32(DIR_RIGHT)));
+        __m256i dy = _mm256_sub_epi32(_mm256_cmpeq_epi32(action, _mm256_set1_epi32(DIR_UP)),
+                                      _mm256_cmpeq_epi32(action, _mm256_set1_epi32(DIR_DOWN)));
+        __m256i reverse = _mm256_and_si256(_mm256_cmpeq_epi32(dx, _mm256_sub_epi32(zero, curX)),
+                                           _mm256_cmpeq_epi32(dy, _mm256_sub_epi32(zero, curY)));
+        __m256i none = _mm256_cmpeq_epi32(action, _mm256_set1_epi32(DIR_NONE));
+        __m256i turn = _mm256_andnot_si256(_mm256_or_si256(reverse, none), live);
+        curX = _mm256_blendv_epi8(curX, dx, turn);
+        curY = _mm256_blendv_epi8(curY, dy, turn);
+        _mm256_storeu_si256((__m256i*)&dirX[g], curX);
+        _mm256_storeu_si256((__m256i*)&dirY[g], curY);
+
+        __m256i oldX = _mm256_loadu_si256((const __m256i*)&headX[g]);
+        __m256i oldY = _mm256_loadu_si256((const __m256i*)&headY[g]);
+        __m256i x = _mm256_add_epi32(oldX, curX);
+        __m256i y = _mm256_add_epi32(oldY, curY);
+        __m256i lowX = _mm256_cmpgt_epi32(zero, x);
+        __m256i highX = _mm256_cmpgt_epi32(x, last);
+        __m256i lowY = _mm256_cmpgt_epi32(zero, y);
+        __m256i highY = _mm256_cmpgt_epi32(y, last);
+        __m256i outside = _mm256_or_si256(_mm256_or_si256(lowX, highX), _mm256_or_si256(lowY, highY));
+
+        __m256i wall;
+        if (wallsEnabled) {
+            wall = outside;
+        } else {
+            wall = zero;
+            x = _mm256_blendv_epi8(_mm256_blendv_epi8(x, zero, highX), last, lowX);
+            y = _mm256_blendv_epi8(_mm256_blendv_epi8(y, zero, highY), last, lowY);
+        }
+        __m256i index = _mm256_andnot_si256(wall, _mm256_add_epi32(_mm256_mullo_epi32(y, n), x));
+        __m256i apple = _mm256_loadu_si256((const __m256i*)&appleIndex[g]);
+        __m256i eat = _mm256_andnot_si256(wall, _mm256_cmpeq_epi32(index, apple));
+
+        _mm256_storeu_si256((__m256i*)&hitWall[g], _mm256_and_si256(wall, one));
+        _mm256_storeu_si256((__m256i*)&nextIndex[g], index);
+        _mm256_storeu_si256((__m256i*)&ate[g], _mm256_and_si256(eat, one));
+        __m256i move = _mm256_andnot_si256(wall, live);
+        _mm256_storeu_si256((__m256i*)&headX[g], _mm256_blendv_epi8(oldX, x, move));
+        _mm256_storeu_si256((__m256i*)&headY[g], _mm256_blendv_epi8(oldY, y, move));
+    }
+#elif defined(__SSE4_1__)
+    void MoveHeadsSse41(const int32_t* actions, int g) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i n = _mm_set1_epi32(cellCount);
+        const __m128i last = _mm_set1_epi32(cellCount - 1);
+
+        __m128i action = _mm_loadu_si128((const __m128i*)(actions + g));
+        __m128i live = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)&alive[g]), zero);
+        __m128i curX = _mm_loadu_si128((const __m128i*)&dirX[g]);
+        __m128i curY = _mm_loadu_si128((const __m128i*)&dirY[g]);
+
+        __m128i dx = _mm_sub_epi32(_mm_cmpeq_epi32(action, _mm_set1_epi32(DIR_LEFT)),
+                                   _mm_cmpeq_epi32(action, _mm_set1_epi32(DIR_RIGHT)));
+        __m128i dy = _mm_sub_epi32(_mm_cmpeq_epi32(action, _mm_set1_epi32(DIR_UP)),
+                                   _mm_cmpeq_epi32(action, _mm_set1_epi32(DIR_DOWN)));
+        __m128i reverse = _mm_and_si128(_mm_cmpeq_epi32(dx, _mm_sub_epi32(zero, curX)),
+                                        _mm_cmpeq_epi32(dy, _mm_sub_epi32(zero, curY)));
+        __m128i none = _mm_cmpeq_epi32(action, _mm_set1_epi32(DIR_NONE));
+        __m128i turn = _mm_andnot_si128(_mm_or_si128(reverse, none), live);
+        curX = _mm_blendv_epi8(curX, dx, turn);
+        curY = _mm_blendv_epi8(curY, dy, turn);
+        _mm_storeu_si128((__m128i*)&dirX[g], curX);
+        _mm_storeu_si128((__m128i*)&dirY[g], curY);
+
+        __m128i oldX = _mm_loadu_si128((const __m128i*)&headX[g]);
+        __m128i oldY = _mm_loadu_si128((const __m128i*)&headY[g]);
+        __m128i x = _mm_add_epi32(oldX, curX);
+        __m128i y = _mm_add_epi32(oldY, curY);
+        __m128i lowX = _mm_cmplt_epi32(x, zero);
+        __m128i highX = _mm_cmpgt_epi32(x, last);
+        __m128i lowY = _mm_cmplt_epi32(y, zero);
+        __m128i highY = _mm_cmpgt_epi32(y, last);
+        __m128i outside = _mm_or_si128(_mm_or_si128(lowX, highX), _mm_or_si128(lowY, highY));
+
+        __m128i wall;
+        if (wallsEnabled) {
+            wall = outside;
+        } else {
+            wall = zero;
+            x = _mm_blendv_epi8(_mm_blendv_epi8(x, zero, highX), last, lowX);
+            y = _mm_blendv_epi8(_mm_blendv_epi8(y, zero, highY), last, lowY);
+        }
+        __m128i index = _mm_andnot_si128(wall, _mm_add_epi32(_mm_mullo_epi32(y, n), x));
+        __m128i apple = _mm_loadu_si128((const __m128i*)&appleIndex[g]);
+        __m128i eat = _mm_andnot_si128(wall, _mm_cmpeq_epi32(index, apple));
+
+        _mm_storeu_si128((__m128i*)&hitWall[g], _mm_and_si128(wall, one));
+        _mm_storeu_si128((__m128i*)&nextIndex[g], index);
+        _mm_storeu_si128((__m128i*)&ate[g], _mm_and_si128(eat, one));
+        __m128i move = _mm_andnot_si128(wall, live);
+        _mm_storeu_si128((__m128i*)&headX[g], _mm_blendv_epi8(oldX, x, move));
+        _mm_storeu_si128((__m128i*)&headY[g], _mm_blendv_epi8(oldY, y, move));
+    }
+#endif
+
+    // Body, occupancy and spawn updates; these touch per-game memory at
+    // data-dependent offsets, so they stay scalar.
+    void FinishStep(int g) {
+        if (hitWall[g]) {
+            alive[g] = 0;
+            return;
+        }
+        uint8_t* occ = &occupied[(size_t)g * cellTotal];
+        int head = nextIndex[g];
+        int tail = BodyIndexAt(g, length[g] - 1);
+        bool grew = growPending[g] != 0;
+        if (grew) {
+            growPending[g] = 0;
+        } else {
+            length[g]--;
+            occ[tail] = 0;
+            InsertFree(g, tail);
+        }
+
+        if (occ[head]) {
+            if (!grew) {
+                PushBack(g, tail);
+                occ[tail] = 1;
+                RemoveFree(g, tail);
+            }
+            // The head was already advanced in the vector phase; put it back.
+            int previous = BodyIndexAt(g, 0);
+            headX[g] = previous % cellCount;
+            headY[g] = previous / cellCount;
+            alive[g] = 0;
+            return;
+        }
+        PushFront(g, head);
+        occ[head] = 1;
+        RemoveFree(g, head);
+
+        if (ate[g]) {
+            growPending[g] = 1;
+            score[g]++;
+            if (freeCount[g] == 0) {
+                alive[g] = 0;
+                won[g] = 1;
+                return;
+            }
+            appleIndex[g] = PickFree(g);
+        }
+    }
+
+    void PushFront(int g, int index) {
+        int first = bodyFirst[g] == 0 ? cellTotal - 1 : bodyFirst[g] - 1;
+        bodyFirst[g] = first;
+        bodies[(size_t)g * cellTotal + first] = (uint16_t)index;
+        length[g]++;
+    }
+
+    void PushBack(int g, int index) {
+        int slot = bodyFirst[g] + length[g];
+        if (slot >= cellTotal) slot -= cellTotal;
+        bodies[(size_t)g * cellTotal + slot] = (uint16_t)index;
+        length[g]++;
+    }
+
+    void InsertFree(int g, int cell) {
+        int32_t* slots = &freeSlots[(size_t)g * cellTotal];
+        if (slots[cell] >= 0) {
+            return;
+        }
+        slots[cell] = freeCount[g];
+        freeCells[(size_t)g * cellTotal + freeCount[g]] = cell;
+        freeCount[g]++;
+    }
+
+    void RemoveFree(int g, int cell) {
+        int32_t* cells = &freeCells[(size_t)g * cellTotal];
+        int32_t* slots = &freeSlots[(size_t)g * cellTotal];
+        int slot = slots[cell];
+        if (slot < 0) {
+            return;
+        }
+        int last = cells[freeCount[g] - 1];
+        cells[slot] = last;
+        slots[last] = slot;
+        freeCount[g]--;
+        slots[cell] = -1;
+    }
+
+    int PickFree(int g) {
+        return freeCells[(size_t)g * cellTotal + rngs[g].Below(freeCount[g])];
+    }
+};
@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+// Microbenchmarks for the hot paths of the game rules, over a grid of board
+// sizes and fill ratios (the share of the board covered by the snake).
+//
+//   snake_bench [--out FILE] [--baseline FILE] [--threshold PERCENT]
+//               [--filter NAME] [--quick]
+//
+// Each result is printed as one JSON object per line; --out also writes them
+// to FILE as a single JSON document. --baseline compares against an earlier
+// run. It prints the change for every case and exits with status 2 if any
+// case got slower by more than --threshold (default 10%).
+//
+// Each case sets up a snake of the requested length laid along a cycle that
+// covers the whole (wrap-around) board, so stepping along the cycle never
+// dies and the fill ratio stays where it was put.
+
+using namespace std;
+
+struct BenchOptions {
+    const char* outPath = nullptr;
+    const char* baselinePath = nullptr;
+    const char* filter = nullptr;
+    double threshold = 10.0;
+    bool quick = false;
+};
+
+struct BenchResult {
+    string name;
+    int grid = 0;
+    int fill = 0;
+    double nsPerOp = 0;
+    long long ops = 0;
+};
+
+// What each benchmark covers, and the function it stands in for from before
+// the rules moved into simulation.h.
+struct BenchCase {
+    const char* name;
+    const char* replaces;
+};
+
+static const BenchCase CASES[] = {
+    {"step", "Snake::Update"},
+    {"step_eat", "CheckCollisionWithFood"},
+    {"is_safe_move", "CheckCollisionWithTail"},
+    {"random_free_cell", "Apple::GenerateRandomPosition"},
+    {"is_occupied", "ElementInDeque"},
+};
+
+static const int GRIDS[] = {15, 20, 25, 64, 256, 1024, 4096};
+static const int FILLS[] = {10, 25, 50, 75, 90, 99};
+
+// Keeps results alive so the compiler cannot drop the measured work.
+static volatile long long sink;
+
+// Visits every cell of an n x n torus: n - 1 steps right, then one down.
+// Each row is entered one column further left, so after n rows the path is
+// back at the start.
+struct BoardCycle {
+    vector<int> order;
+    vector<uint8_t> nextDirection;
+
+    void Build(int n) {
+        order.clear();
+        nextDirection.assign((size_t)n * n, DIR_RIGHT);
+        int x = 0;
+        int y = 0;
+        for (int row = 0; row < n; row++) {
+            for (int step = 0; step < n; step++) {
+                order.push_back(y * n + x);
+                if (step < n - 1) {
+                    x = (x + 1) % n;
+                } else {
+                    nextDirection[(size_t)y * n + x] = DIR_DOWN;
+                    y = (y + 1) % n;
+                }
+            }
+        }
+    }
+};
+
+// A snake covering fill percent of the board along the cycle, heading on
+// along it. Walls are off so the cycle can wrap.
+static void SetUpBoard(Simulation& sim, const BoardCycle& cycle, int n, int fill) {
+    SimConfig config;
+    config.cellCount = n;
+    config.wallsEnabled = false;
+    config.seed = 12345;
+    sim.Configure(config);
+
+    int cells = n * n;
+    int length = (int)lround(cells * fill / 100.0);
+    length = max(3, min(length, cells - 1));
+    vector<int> body(length);
+    for (int i = 0; i < length; i++) {
+        body[i] = cycle.order[length - 1 - i];
+    }
+    sim.SetBody(body.data(), length, nullptr, 0);
+    sim.direction = (Direction)cycle.nextDirection[body[0]];
+    sim.growPending = false;
+    sim.alive = true;
+    sim.apple = sim.RandomFreeCell();
+}
+
+template <typename Body>
+static double TimeSamples(bool quick, long long& totalOps, Body body) {
+    const int batch = 1024;
+    const double sampleSeconds = quick ? 0.01 : 0.05;
+    const int samples = quick ? 3 : 5;
+    vector<double> perOp;
+    totalOps = 0;
+    body(batch);
+    for (int s = 0; s < samples; s++) {
+        long long ops = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        do {
+            body(batch);
+            ops += batch;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < sampleSeconds);
+        perOp.push_back(elapsed * 1e9 / ops);
+        totalOps += ops;
+    }
+    sort(perOp.begin(), perOp.end());
+    return perOp[perOp.size() / 2];
+}
+
+static double RunCase(const char* name, int n, int fill, bool quick, long long& ops) {
+    BoardCycle cycle;
+    cycle.Build(n);
+    Simulation sim;
+    SetUpBoard(sim, cycle, n, fill);
+    int cells = n * n;
+
+    // Random cells drawn up front so the timing does not include the RNG.
+    Rng rng(7);
+    vector<int> probes(4096);
+    for (int& probe : probes) probe = rng.Below(cells);
+
+    if (strcmp(name, "step") == 0) {
+        // Growth is cancelled after every step so the length stays fixed; the
+        // apple is still eaten and respawned whenever the head reaches it.
+        return TimeSamples(quick, ops, [&](int count) {
+            for (int i = 0; i < count; i++) {
+                Direction dir = (Direction)cycle.nextDirection[sim.body.IndexAt(0)];
+                sim.Step(dir);
+                sim.growPending = false;
+            }
+            sink = sim.score;
+        });
+    }
+    if (strcmp(name, "step_eat") == 0) {
+        // The apple is moved in front of the head each tick, so every step
+        // takes the eating path and spawns a new apple.
+        return TimeSamples(quick, ops, [&](int count) {
+            for (int i = 0; i < count; i++) {
+                int head = sim.body.IndexAt(0);
+                Direction dir = (Direction)cycle.nextDirection[head];
+                Cell next;
+                sim.NextCell(dir, next);
+                sim.apple = next;
+                sim.Step(dir);
+                sim.growPending = false;
+            }
+            sink = sim.score;
+        });
+    }
+    if (strcmp(name, "is_safe_move") == 0) {
+        return TimeSamples(quick, ops, [&](int count) {
+            long long safe = 0;
+            for (int i = 0; i < count; i++) {
+                safe += sim.IsSafeMove((Direction)(1 + (i & 3)));
+            }
+            sink = safe;
+        });
+    }
+    if (strcmp(name, "random_free_cell") == 0) {
+        return TimeSamples(quick, ops, [&](int count) {
+            long long total = 0;
+            for (int i = 0; i < count; i++) {
+                Cell cell = sim.RandomFreeCell();
+                total += cell.x + cell.y;
+            }
+            sink = total;
+        });
+    }
+    if (strcmp(name, "is_occupied") == 0) {
+        return TimeSamples(quick, ops, [&](int count) {
+            long long hits = 0;
+            for (int i = 0; i < count; i++) {
+                int index = probes[i & 4095];
+                hits += sim.IsOccupied(Cell{index % n, index / n});
+            }
+            sink = hits;
+        });
+    }
+    return 0;
+}
+
+static string ResultJson(const BenchResult& result) {
+    const char* replaces = "";
+    for (const BenchCase& c : CASES) {
+        if (result.name == c.name) replaces = c.replaces;
+    }
+    char line[256];
+    snprintf(line, sizeof(line),
+             "{\"name\":\"%s\",\"replaces\":\"%s\",\"grid\":%d,\"fill\":%d,\"ns_per_op\":%.3f,\"ops\":%lld}",
+             result.name.c_str(), replaces, result.grid, result.fill, result.nsPerOp, result.ops);
+    return line;
+}
+
+// Reads the lines written by ResultJson; anything else in the file is
+// skipped.
+static bool LoadResults(const char* path, vector<BenchResult>& results) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char name[64];
+        BenchResult result;
+        const char* start = strstr(line, "{\"name\":\"");
+        if (start == nullptr) continue;
+        if (sscanf(start, "{\"name\":\"%63[^\"]\"", name) != 1) continue;
+        const char* grid = strstr(start, "\"grid\":");
+        const char* fill = strstr(start, "\"fill\":");
+        const char* ns = strstr(start, "\"ns_per_op\":");
+        if (grid == nullptr || fill == nullptr || ns == nullptr) continue;
+        result.name = name;
+        result.grid = atoi(grid + 7);
+        result.fill = atoi(fill + 7);
+        result.nsPerOp = atof(ns + 12);
+        results.push_back(result);
+    }
+    fclose(file);
+    return true;
+}
+
+static int Compare(const vector<BenchResult>& current, const vector<BenchResult>& baseline, double threshold) {
+    int regressions = 0;
+    fprintf(stderr, "\n%-18s %5s %5s %10s %10s %8s\n", "benchmark", "grid", "fill", "base ns", "now ns", "change");
+    for (const BenchResult& now : current) {
+        const BenchResult* base = nullptr;
+        for (const BenchResult& candidate : baseline) {
+            if (candidate.name == now.name && candidate.grid == now.grid && candidate.fill == now.fill) {
+                base = &candidate;
+            }
+        }
+        if (base == nullptr || base->nsPerOp <= 0) {
+            fprintf(stderr, "%-18s %5d %4d%% %10s %10.2f %8s\n", now.name.c_str(), now.grid, now.fill, "-", now.nsPerOp, "new");
+            continue;
+        }
+        double change = (now.nsPerOp / base->nsPerOp - 1.0) * 100.0;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        fprintf(stderr, "%-18s %5d %4d%% %10.2f %10.2f %+7.1f%%%s\n", now.name.c_str(), now.grid, now.fill,
+                base->nsPerOp, now.nsPerOp, change, regressed ? "  SLOWER" : "");
+    }
+    fprintf(stderr, "\n%d case(s) slower than the baseline by more than %.1f%%\n", regressions, threshold);
+    return regressions;
+}
+
+static bool ParseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--quick") == 0) {
+            options.quick = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+        if (strcmp(arg, "--out") == 0) {
+            options.outPath = value;
+        } else if (strcmp(arg, "--baseline") == 0) {
+            options.baselinePath = value;
+        } else if (strcmp(arg, "--threshold") == 0) {
+            options.threshold = atof(value);
+        } else if (strcmp(arg, "--filter") == 0) {
+            options.filter = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    vector<BenchResult> baseline;
+    if (options.baselinePath != nullptr && !LoadResults(options.baselinePath, baseline)) {
+        fprintf(stderr, "Could not read baseline %s\n", options.baselinePath);
+        return 1;
+    }
+
+    vector<BenchResult> results;
+    string json = "{\"benchmarks\":[\n";
+    for (const BenchCase& c : CASES) {
+        if (options.filter != nullptr && strstr(c.name, options.filter) == nullptr) {
+            continue;
+        }
+        for (int grid : GRIDS) {
+            for (int fill : FILLS) {
+                BenchResult result;
+                result.name = c.name;
+                result.grid = grid;
+                result.fill = fill;
+                result.nsPerOp = RunCase(c.name, grid, fill, options.quick, result.ops);
+                string line = ResultJson(result);
+                printf("%s\n", line.c_str());
+                fflush(stdout);
+                json += (results.empty() ? "" : ",\n") + line;
+                results.push_back(result);
+            }
+        }
+    }
+    json += "\n]}\n";
+
+    if (options.outPath != nullptr) {
+        FILE* file = fopen(options.outPath, "w");
+        if (file == nullptr) {
+            fprintf(stderr, "Could not write %s\n", options.outPath);
+            return 1;
+        }
+        fputs(json.c_str(), file);
+        fclose(file);
+    }
+    if (options.baselinePath != nullptr) {
+        return Compare(results, baseline, options.threshold) > 0 ? 2 : 0;
+    }
+    return 0;
+}
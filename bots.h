@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdlib>
+#include <cstring>
+
+#include "simulation.h"
+#include "autopilot.h"
+
+// Simple scripted players for the headless tools. A bot looks at the
+// simulation and returns the input for the next tick.
+
+typedef Direction (*BotFunction)(const Simulation& sim, Rng& rng);
+
+static const Direction ALL_DIRECTIONS[] = {DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT};
+
+// Turns randomly now and then, and avoids moves that would die immediately
+// when it can.
+inline Direction RandomBot(const Simulation& sim, Rng& rng) {
+    Direction preferred = rng.Below(4) == 0 ? ALL_DIRECTIONS[rng.Below(4)] : sim.direction;
+    if (sim.CanTurn(preferred) && sim.IsSafeMove(preferred)) {
+        return preferred;
+    }
+    int start = rng.Below(4);
+    for (int i = 0; i < 4; i++) {
+        Direction dir = ALL_DIRECTIONS[(start + i) % 4];
+        if (sim.CanTurn(dir) && sim.IsSafeMove(dir)) {
+            return dir;
+        }
+    }
+    return preferred;
+}
+
+// Takes the safe move that gets closest to the apple, measured with
+// wrap-around when walls are off.
+inline Direction GreedyBot(const Simulation& sim, Rng& rng) {
+    Direction best = sim.direction;
+    int bestDistance = -1;
+    int start = rng.Below(4);
+    for (int i = 0; i < 4; i++) {
+        Direction dir = ALL_DIRECTIONS[(start + i) % 4];
+        Cell next;
+        if (!sim.CanTurn(dir) || !sim.IsSafeMove(dir) || !sim.NextCell(dir, next)) {
+            continue;
+        }
+        int dx = abs(next.x - sim.apple.x);
+        int dy = abs(next.y - sim.apple.y);
+        if (!sim.config.wallsEnabled) {
+            if (sim.config.cellCount - dx < dx) dx = sim.config.cellCount - dx;
+            if (sim.config.cellCount - dy < dy) dy = sim.config.cellCount - dy;
+        }
+        int distance = dx + dy;
+        if (bestDistance < 0 || distance < bestDistance) {
+            best = dir;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+// The Autopilot behind the bot signature. Each thread keeps its own, which
+// notices from the seed and tick when a new game has started.
+inline Direction AutopilotBot(const Simulation& sim, Rng&) {
+    thread_local Autopilot pilot;
+    return pilot.Choose(sim);
+}
+
+inline BotFunction FindBot(const char* name) {
+    if (strcmp(name, "random") == 0) return RandomBot;
+    if (strcmp(name, "greedy") == 0) return GreedyBot;
+    if (strcmp(name, "autopilot") == 0) return AutopilotBot;
+    return nullptr;
+}
@@ -0,0 +1,192 @@
+#include "file_writer.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+FileWriter fileWriter;
+
+void FileWriter::Write(const std::string& path, std::vector<uint8_t> contents) {
+    Queue(Job{path, std::move(contents), JOB_WRITE});
+}
+
+void FileWriter::Append(const std::string& path, const std::vector<uint8_t>& bytes) {
+    Queue(Job{path, bytes, JOB_APPEND});
+}
+
+void FileWriter::Remove(const std::string& path) {
+    Queue(Job{path, std::vector<uint8_t>(), JOB_REMOVE});
+}
+
+void FileWriter::Queue(Job job) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Job* waiting = nullptr;
+    for (Job& candidate : jobs) {
+        if (candidate.path == job.path) {
+            waiting = &candidate;
+        }
+    }
+    if (waiting == nullptr) {
+        jobs.push_back(std::move(job));
+    } else if (job.kind == JOB_APPEND && waiting->kind != JOB_REMOVE) {
+        // Still a write or an append, just longer.
+        waiting->contents.insert(waiting->contents.end(), job.contents.begin(), job.contents.end());
+    } else if (job.kind == JOB_APPEND) {
+        // Removing then appending leaves just the appended bytes.
+        waiting->contents = std::move(job.contents);
+        waiting->kind = JOB_WRITE;
+    } else {
+        *waiting = std::move(job);
+    }
+    if (!thread.joinable()) {
+        stopping = false;
+        thread = std::thread([this]() { Loop(); });
+    }
+    wake.notify_one();
+}
+
+void FileWriter::Flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return jobs.empty() && !busy; });
+}
+
+void FileWriter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!thread.joinable()) {
+            return;
+        }
+        stopping = true;
+        wake.notify_one();
+    }
+    thread.join();
+}
+
+void FileWriter::Loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this]() { return !jobs.empty() || stopping; });
+        if (jobs.empty()) {
+            // Only stop once everything queued is on disk.
+            break;
+        }
+        std::vector<Job> batch;
+        batch.swap(jobs);
+        busy = true;
+        lock.unlock();
+        for (const Job& job : batch) {
+            bool ok = true;
+            if (job.kind == JOB_REMOVE) {
+                remove(job.path.c_str());
+            } else if (job.kind == JOB_APPEND) {
+                ok = AppendToFile(job.path.c_str(), job.contents.data(), job.contents.size());
+            } else {
+                ok = WriteFileAtomically(job.path.c_str(), job.contents.data(), job.contents.size());
+            }
+            if (!ok) {
+                fprintf(stderr, "Could not save %s\n", job.path.c_str());
+            }
+        }
+        lock.lock();
+        busy = false;
+        if (jobs.empty()) {
+            idle.notify_all();
+        }
+    }
+    idle.notify_all();
+}
+
+#ifdef _WIN32
+
+bool WriteFileAtomically(const char* path, const void* data, size_t size) {
+    std::string temp = std::string(path) + ".tmp";
+    HANDLE file = CreateFileA(temp.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD written = 0;
+    bool ok = WriteFile(file, data, (DWORD)size, &written, NULL) && written == size;
+    ok = FlushFileBuffers(file) && ok;
+    CloseHandle(file);
+    if (ok) {
+        ok = MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+    }
+    if (!ok) {
+        DeleteFileA(temp.c_str());
+    }
+    return ok;
+}
+
+bool AppendToFile(const char* path, const void* data, size_t size) {
+    HANDLE file = CreateFileA(path, FILE_APPEND_DATA, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD written = 0;
+    bool ok = WriteFile(file, data, (DWORD)size, &written, NULL) && written == size;
+    ok = FlushFileBuffers(file) && ok;
+    CloseHandle(file);
+    return ok;
+}
+
+#else
+
+bool WriteFileAtomically(const char* path, const void* data, size_t size) {
+    std::string temp = std::string(path) + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const char* bytes = (const char*)data;
+    size_t done = 0;
+    bool ok = true;
+    while (ok && done < size) {
+        ssize_t count = write(fd, bytes + done, size - done);
+        ok = count > 0;
+        done += ok ? (size_t)count : 0;
+    }
+    ok = fsync(fd) == 0 && ok;
+    ok = close(fd) == 0 && ok;
+    if (ok) {
+        ok = rename(temp.c_str(), path) == 0;
+    }
+    if (!ok) {
+        unlink(temp.c_str());
+        return false;
+    }
+    // Make the rename itself durable.
+    std::string directory = path;
+    size_t slash = directory.find_last_of('/');
+    directory = slash == std::string::npos ? "." : directory.substr(0, slash + 1);
+    int dir = open(directory.c_str(), O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        close(dir);
+    }
+    return true;
+}
+
+bool AppendToFile(const char* path, const void* data, size_t size) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const char* bytes = (const char*)data;
+    size_t done = 0;
+    bool ok = true;
+    while (ok && done < size) {
+        ssize_t count = write(fd, bytes + done, size - done);
+        ok = count > 0;
+        done += ok ? (size_t)count : 0;
+    }
+    ok = fsync(fd) == 0 && ok;
+    return close(fd) == 0 && ok;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Saves files on a background thread so the game loop never waits on the
+// disk. Work is coalesced per path: queuing a file while an older version
+// of it is still waiting replaces that version, so a burst of high scores
+// costs one write, and appends queued behind a waiting job are joined onto
+// it. Platform headers stay in file_writer.cpp, away from raylib.
+class FileWriter {
+public:
+    FileWriter() {}
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+    ~FileWriter() {
+        Stop();
+    }
+
+    void Write(const std::string& path, std::vector<uint8_t> contents);
+    // Adds bytes to the end of the file, creating it if needed.
+    void Append(const std::string& path, const std::vector<uint8_t>& bytes);
+    void Remove(const std::string& path);
+
+    // Blocks until everything queued so far has been written.
+    void Flush();
+    // Flushes, then ends the thread. Later writes start it again.
+    void Stop();
+
+private:
+    enum JobKind { JOB_WRITE, JOB_APPEND, JOB_REMOVE };
+
+    struct Job {
+        std::string path;
+        std::vector<uint8_t> contents;
+        JobKind kind;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::vector<Job> jobs;
+    bool busy = false;
+    bool stopping = false;
+    std::thread thread;
+
+    void Queue(Job job);
+    void Loop();
+};
+
+// Replaces path with data so that a crash or power loss leaves either the old
+// file or the new one, never a torn mix: the data goes to a temporary file
+// beside it, is flushed to the disk, then renamed over path.
+bool WriteFileAtomically(const char* path, const void* data, size_t size);
+
+// Appends data to path and flushes it to the disk. A crash can leave a
+// partial record at the end, so readers must tolerate one.
+bool AppendToFile(const char* path, const void* data, size_t size);
+
+extern FileWriter fileWriter;
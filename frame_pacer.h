@@ -0,0 +1,180 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "profiler.h"
+
+// Frame pacing in place of raylib's SetTargetFPS wait. Wait is called just
+// before the frame is presented and returns at its slot: it sleeps through
+// most of the gap, then spins (yielding) for the last stretch, because
+// sleeping alone wakes anywhere up to a scheduler quantum late. The spin is
+// sized from how late recent sleeps have woken, so it stays a fraction of a
+// millisecond where the OS timer is good and only grows where it is not.
+//
+// Slots are a fixed cadence (each one period after the last), not a period
+// after whenever the frame finished, so a slow frame is made up on the next
+// one instead of shifting every later frame. A frame more than a period
+// late, such as the first after sleeping on input, starts a new cadence.
+//
+// Optionally a slot is pulled in to just after the next simulation tick
+// falls due, so the frame that runs the tick starts straight away instead of
+// up to a whole frame later.
+//
+// Every paced frame records how far from its slot it was actually presented
+// and the interval since the previous one. Nothing in here depends on
+// raylib.
+class FramePacer {
+public:
+    static const int HISTORY = 512;
+
+    // Summary of the last HISTORY paced frames, in milliseconds, refreshed a
+    // few times a second.
+    struct Stats {
+        double errorP50 = 0;
+        double errorP99 = 0;
+        double errorMax = 0;
+        double intervalP50 = 0;
+        double intervalP99 = 0;
+        double spin = 0;
+        long long lateFrames = 0;
+    };
+
+    Stats stats;
+    bool alignToTicks = false;
+
+    // 0 leaves frames unpaced.
+    void SetTarget(int fps) {
+        target = fps;
+        period = fps > 0 ? 1000000000ull / fps : 0;
+        slot = 0;
+    }
+
+    int Target() const {
+        return target;
+    }
+
+    // tickDue is when the next simulation tick falls due (ProfileNow time),
+    // or 0 when none is scheduled.
+    void Wait(uint64_t tickDue = 0) {
+        uint64_t now = ProfileNow();
+        if (period == 0) {
+            Presented(now, now);
+            return;
+        }
+        uint64_t next = slot + period;
+        if (slot == 0 || now > next + period) {
+            // First frame, or woken after a long gap: nothing to catch up.
+            slot = now;
+            lastPresent = now;
+            return;
+        }
+        if (alignToTicks && tickDue > slot && tickDue + ALIGN_MARGIN < next) {
+            next = tickDue + ALIGN_MARGIN;
+        }
+        if (now >= next) {
+            // The frame itself overran its slot; it goes out now.
+            lateFrames++;
+            Presented(next, now);
+            return;
+        }
+        uint64_t spin = (uint64_t)Spin();
+        if (next - now > spin) {
+            uint64_t wake = next - spin;
+            std::this_thread::sleep_for(std::chrono::nanoseconds(wake - now));
+            now = ProfileNow();
+            // Rises quickly towards late wakes and falls slowly, so it
+            // tracks the worst of recent sleeps without one stray
+            // preemption setting the spin for the next few seconds.
+            double late = now > wake ? (double)(now - wake) : 0.0;
+            oversleep += (late - oversleep) * (late > oversleep ? 0.25 : 0.02);
+        }
+        while (now < next) {
+            std::this_thread::yield();
+            now = ProfileNow();
+        }
+        Presented(next, now);
+    }
+
+    void Report(FILE* out) {
+        Summarise();
+        if (target == 0) {
+            fprintf(out, "frame pacing: unpaced, interval p50 %.2f ms, p99 %.2f ms\n", stats.intervalP50,
+                    stats.intervalP99);
+            return;
+        }
+        fprintf(out, "frame pacing at %d fps: error p50 %.3f, p99 %.3f, max %.3f ms; interval p50 %.2f, p99 %.2f ms; "
+                     "spin %.2f ms; %lld late frames\n",
+                target, stats.errorP50, stats.errorP99, stats.errorMax, stats.intervalP50, stats.intervalP99,
+                stats.spin, stats.lateFrames);
+    }
+
+private:
+    // Margins in nanoseconds. A tick-aligned slot lands just after the tick
+    // so the frame's clock read is sure to see it due.
+    static constexpr uint64_t ALIGN_MARGIN = 100000;
+    static constexpr double SPIN_PADDING = 100000.0;
+    static constexpr double MIN_SPIN = 200000.0;
+    static constexpr double MAX_SPIN = 3000000.0;
+
+    int target = 0;
+    uint64_t period = 0;
+    uint64_t slot = 0;
+    uint64_t lastPresent = 0;
+    uint64_t lastSummary = 0;
+    double oversleep = 0.0;
+    long long lateFrames = 0;
+
+    double errors[HISTORY] = {};
+    double intervals[HISTORY] = {};
+    int cursor = 0;
+    int filled = 0;
+
+    void Presented(uint64_t scheduled, uint64_t now) {
+        if (lastPresent != 0) {
+            errors[cursor] = (now - scheduled) * 1e-6;
+            intervals[cursor] = (now - lastPresent) * 1e-6;
+            cursor = (cursor + 1) % HISTORY;
+            if (filled < HISTORY) filled++;
+        }
+        slot = scheduled;
+        lastPresent = now;
+        if (now - lastSummary > 250000000ull) {
+            Summarise();
+            lastSummary = now;
+        }
+    }
+
+    // Spinning for more than a quarter of every frame would cost more CPU
+    // than the pacing is worth.
+    double Spin() const {
+        double spin = std::min(std::max(oversleep + SPIN_PADDING, MIN_SPIN), MAX_SPIN);
+        return std::min(spin, period / 4.0);
+    }
+
+    static double Percentile(std::vector<double>& values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        size_t k = (size_t)(p * (values.size() - 1));
+        std::nth_element(values.begin(), values.begin() + k, values.end());
+        return values[k];
+    }
+
+    void Summarise() {
+        std::vector<double> error(errors, errors + filled);
+        stats.errorP50 = Percentile(error, 0.5);
+        stats.errorP99 = Percentile(error, 0.99);
+        stats.errorMax = error.empty() ? 0 : *std::max_element(error.begin(), error.end());
+        std::vector<double> interval(intervals, intervals + filled);
+        stats.intervalP50 = Percentile(interval, 0.5);
+        stats.intervalP99 = Percentile(interval, 0.99);
+        stats.spin = Spin() * 1e-6;
+        stats.lateFrames = lateFrames;
+    }
+};
+
+inline FramePacer framePacer;
@@ -1,211 +1,656 @@
 #pragma once
 #include "raylib.h"
-#include "raymath.h"
+#include "rlgl.h"
 #include "globals.h"
-#include <deque>
+#include "simulation.h"
+#include "replay.h"
+#include "autopilot.h"
+#include "file_writer.h"
+#include "leaderboard.h"
+#include "asset_pack.h"
+#include "input.h"
+#include "latency.h"
+#include "profiler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
 
 using namespace std;
 
+// Where the board is on screen and which part of it is visible. Boards that
+// fit in MAX_BOARD_VIEW are shown whole at cellSize pixels per cell, exactly
+// as before. Bigger boards get a square view that follows the head and can
+// be zoomed, from two cells per cellSize down to the whole board.
+//
+// Everything on the board is drawn in world units (cell * cellSize) inside
+// BeginMode2D(camera), clipped to View().
+class BoardCamera {
+public:
+    Camera2D camera = {{0, 0}, {0, 0}, 0.0f, 1.0f};
+    // On-screen pixels per cell.
+    float cellPixels = 0;
+    // The point being followed, in cells.
+    Vector2 focus = {0, 0};
+    int boardCells = 0;
+
+    bool Scrolls() const {
+        return (long long)boardCells * cellSize > MAX_BOARD_VIEW;
+    }
+
+    Rectangle View() const {
+        float size = (float)GetBoardViewSize();
+        return Rectangle{(float)GetGameOffsetX(), (float)GetGameOffsetY(), size, size};
+    }
+
+    void Reset(const Simulation& sim) {
+        boardCells = sim.config.cellCount;
+        cellPixels = (float)cellSize;
+        Cell head = sim.Head();
+        focus = Vector2{head.x + 0.5f, head.y + 0.5f};
+    }
+
+    void Zoom(float factor) {
+        float fit = (float)MAX_BOARD_VIEW / boardCells;
+        cellPixels *= factor;
+        if (cellPixels > cellSize * 2.0f) cellPixels = cellSize * 2.0f;
+        if (cellPixels < fit) cellPixels = fit;
+    }
+
+    // head is the interpolated head position in cells.
+    void Update(const Simulation& sim, Vector2 head) {
+        if (boardCells != sim.config.cellCount) {
+            Reset(sim);
+        }
+        Rectangle view = View();
+        if (!Scrolls()) {
+            camera.offset = Vector2{view.x, view.y};
+            camera.target = Vector2{0, 0};
+            camera.zoom = 1.0f;
+            return;
+        }
+
+        // Ease towards the head; jump when it wraps across the board.
+        Vector2 target = {head.x + 0.5f, head.y + 0.5f};
+        float viewCells = view.width / cellPixels;
+        if (fabsf(target.x - focus.x) > viewCells || fabsf(target.y - focus.y) > viewCells) {
+            focus = target;
+        } else {
+            float follow = 1.0f - expf(-10.0f * GetFrameTime());
+            focus.x += (target.x - focus.x) * follow;
+            focus.y += (target.y - focus.y) * follow;
+        }
+
+        // Keep the view on the board.
+        float half = viewCells / 2;
+        float x = focus.x;
+        float y = focus.y;
+        if (viewCells >= boardCells) {
+            x = y = boardCells / 2.0f;
+        } else {
+            x = x < half ? half : (x > boardCells - half ? boardCells - half : x);
+            y = y < half ? half : (y > boardCells - half ? boardCells - half : y);
+        }
+        camera.offset = Vector2{view.x + view.width / 2, view.y + view.height / 2};
+        camera.target = Vector2{x * cellSize, y * cellSize};
+        camera.zoom = cellPixels / cellSize;
+    }
+
+    // Cells touching the view, widened by one so segments sliding in from
+    // just outside are included.
+    void VisibleCells(int& x0, int& y0, int& x1, int& y1) const {
+        Rectangle view = View();
+        Vector2 topLeft = GetScreenToWorld2D(Vector2{view.x, view.y}, camera);
+        Vector2 bottomRight = GetScreenToWorld2D(Vector2{view.x + view.width, view.y + view.height}, camera);
+        x0 = (int)floorf(topLeft.x / cellSize) - 1;
+        y0 = (int)floorf(topLeft.y / cellSize) - 1;
+        x1 = (int)floorf(bottomRight.x / cellSize) + 2;
+        y1 = (int)floorf(bottomRight.y / cellSize) + 2;
+        x0 = x0 < 0 ? 0 : x0;
+        y0 = y0 < 0 ? 0 : y0;
+        x1 = x1 > boardCells ? boardCells : x1;
+        y1 = y1 > boardCells ? boardCells : y1;
+    }
+};
+
+// The rounded segment is rasterised once into a white texture for the
+// current cellSize, then the body is sent as textured quad batches tinted
+// with the snake colour, instead of tessellating a rounded rectangle per
+// segment every frame.
+//
+// On scrolling boards only what is in view is drawn. When the view holds
+// fewer cells than the snake has segments, the visible cells are scanned
+// instead of the body: the occupancy grid says whether a cell is covered,
+// and a per-cell serial number (when the head entered it) gives the
+// segment's place in the body for interpolation. Zoomed out below
+// LOD_CELL_PIXELS, the body becomes one texture with a texel per block of
+// cells whose alpha is the share of the block covered, drawn as one quad.
 class Snake {
 public:
-    deque<Vector2> body = {Vector2{6, 9}, Vector2{5, 9}, Vector2{4, 9}};
-    Vector2 direction = {1, 0};
-    bool addSegment = false;
+    static const int QUADS_PER_RUN = 1024;
+    static constexpr float LOD_CELL_PIXELS = 2.0f;
+    static const int MAX_LOD_TEXTURE = 2048;
+
+    RenderTexture2D segmentTexture;
+    int bakedSize = 0;
+
+    // Spatial index and LOD texture, only kept for scrolling boards.
+    bool indexed = false;
+    bool stale = true;
+    int trackedCells = 0;
+    uint64_t trackedSeed = 0;
+    uint64_t trackedTick = 0;
+    uint32_t headSerial = 0;
+    std::vector<uint32_t> serials;
+    std::vector<int> changedCells;
+
+    Texture2D lodTexture;
+    bool lodLoaded = false;
+    bool lodStale = true;
+    int lodBlock = 1;
+    int lodSize = 0;
+    std::vector<uint8_t> lodPixels;
+
+    int quadsInRun = 0;
+    Color runColor = WHITE;
+
+    ~Snake() {
+        if (bakedSize > 0) {
+            UnloadRenderTexture(segmentTexture);
+        }
+        if (lodLoaded) {
+            UnloadTexture(lodTexture);
+        }
+    }
 
-    void Draw() {
-        int offsetX = GetGameOffsetX();
-        int offsetY = GetGameOffsetY();
+    void BakeSegment() {
+        if (bakedSize == cellSize) {
+            return;
+        }
+        if (bakedSize > 0) {
+            UnloadRenderTexture(segmentTexture);
+        }
+        segmentTexture = LoadRenderTexture(cellSize, cellSize);
+        BeginTextureMode(segmentTexture);
+        ClearBackground(BLANK);
+        DrawRectangleRounded(Rectangle{0, 0, (float)cellSize, (float)cellSize}, 0.5f, 6, WHITE);
+        EndTextureMode();
+        SetTextureFilter(segmentTexture.texture, TEXTURE_FILTER_BILINEAR);
+        bakedSize = cellSize;
+    }
+
+    // Called by Game after every Step, so the spatial index and the LOD
+    // texture follow the body one tick at a time.
+    void OnStep(const Simulation& sim) {
+        if (!indexed || stale) {
+            return;
+        }
+        if (sim.tick != trackedTick + 1) {
+            stale = true;
+            return;
+        }
+        trackedTick = sim.tick;
+        if (sim.moved) {
+            int head = sim.body.IndexAt(0);
+            serials[head] = ++headSerial;
+            changedCells.push_back(head);
+            if (sim.vacatedTail >= 0) {
+                changedCells.push_back(sim.vacatedTail);
+            }
+        }
+    }
+
+    // alpha is how far we are between the previous tick and the current one;
+    // each segment slides from where it was towards where it is now.
+    void Draw(const Simulation& sim, float alpha, const BoardCamera& view) {
+        BakeSegment();
         Color snakeColor = gameSettings.GetSnakeColor();
-        
-        for (unsigned int i = 0; i < body.size(); i++) {
-            float x = body[i].x;
-            float y = body[i].y;
-            Rectangle segment = Rectangle{(float)(offsetX + x * cellSize), 
-                                          (float)(offsetY + y * cellSize),
-                                          (float)cellSize, (float)cellSize};
-            DrawRectangleRounded(segment, 0.5f, 6, snakeColor);
-            
-            if (i == 0) {
-                Color eyeColor = white;
-                float eyeSize = cellSize * 0.15f;
-                float eyeOffset = cellSize * 0.25f;
-                
-                if (direction.x == 1) {
-                    DrawCircle((int)(segment.x + cellSize - eyeOffset), (int)(segment.y + eyeOffset), eyeSize, eyeColor);
-                    DrawCircle((int)(segment.x + cellSize - eyeOffset), (int)(segment.y + cellSize - eyeOffset), eyeSize, eyeColor);
-                } else if (direction.x == -1) {
-                    DrawCircle((int)(segment.x + eyeOffset), (int)(segment.y + eyeOffset), eyeSize, eyeColor);
-                    DrawCircle((int)(segment.x + eyeOffset), (int)(segment.y + cellSize - eyeOffset), eyeSize, eyeColor);
-                } else if (direction.y == -1) {
-                    DrawCircle((int)(segment.x + eyeOffset), (int)(segment.y + eyeOffset), eyeSize, eyeColor);
-                    DrawCircle((int)(segment.x + cellSize - eyeOffset), (int)(segment.y + eyeOffset), eyeSize, eyeColor);
-                } else {
-                    DrawCircle((int)(segment.x + eyeOffset), (int)(segment.y + cellSize - eyeOffset), eyeSize, eyeColor);
-                    DrawCircle((int)(segment.x + cellSize - eyeOffset), (int)(segment.y + cellSize - eyeOffset), eyeSize, eyeColor);
+        int length = sim.body.Size();
+        if (length == 0) {
+            return;
+        }
+
+        if (!view.Scrolls()) {
+            indexed = false;
+            BeginQuads(snakeColor);
+            for (int i = 0; i < length; i++) {
+                AddSegment(SegmentPosition(sim, i, alpha));
+            }
+            EndQuads();
+            DrawEyes(SegmentPosition(sim, 0, alpha), sim.direction);
+            return;
+        }
+
+        Track(sim);
+        if (view.cellPixels < LOD_CELL_PIXELS) {
+            DrawLod(sim, snakeColor);
+            return;
+        }
+
+        // Changes only matter to the LOD texture, which is rebuilt whole
+        // when it is next shown.
+        changedCells.clear();
+        lodStale = true;
+
+        int x0, y0, x1, y1;
+        view.VisibleCells(x0, y0, x1, y1);
+        long long visibleCells = (long long)(x1 - x0) * (y1 - y0);
+        BeginQuads(snakeColor);
+        if (visibleCells < length) {
+            int n = sim.config.cellCount;
+            for (int y = y0; y < y1; y++) {
+                const uint8_t* row = &sim.occupied[(size_t)y * n];
+                for (int x = x0; x < x1; x++) {
+                    if (!row[x]) continue;
+                    int i = (int)(headSerial - serials[(size_t)y * n + x]);
+                    if (i >= 0 && i < length) {
+                        AddSegment(SegmentPosition(sim, i, alpha));
+                    }
+                }
+            }
+        } else {
+            for (int i = 0; i < length; i++) {
+                Cell cell = sim.body[i];
+                if (cell.x >= x0 && cell.x < x1 && cell.y >= y0 && cell.y < y1) {
+                    AddSegment(SegmentPosition(sim, i, alpha));
                 }
             }
         }
+        EndQuads();
+        DrawEyes(SegmentPosition(sim, 0, alpha), sim.direction);
     }
 
-    void Update() {
-        body.push_front(Vector2Add(body[0], direction));
-        if (addSegment) {
-            addSegment = false;
+    // Position of segment i in cells, between its previous and current cell.
+    Vector2 SegmentPosition(const Simulation& sim, int i, float alpha) const {
+        Cell cell = sim.body[i];
+        float x = (float)cell.x;
+        float y = (float)cell.y;
+        if (sim.moved && alpha < 1.0f) {
+            Cell from = cell;
+            if (i + 1 < sim.body.Size()) {
+                from = sim.body[i + 1];
+            } else if (sim.vacatedTail >= 0) {
+                from = Cell{sim.vacatedTail % sim.config.cellCount, sim.vacatedTail / sim.config.cellCount};
+            }
+            // Segments that wrapped around the board jump instead of
+            // sliding across it.
+            if (abs(from.x - cell.x) <= 1 && abs(from.y - cell.y) <= 1) {
+                x = from.x + (x - from.x) * alpha;
+                y = from.y + (y - from.y) * alpha;
+            }
+        }
+        return Vector2{x, y};
+    }
+
+    void DrawEyes(Vector2 position, Direction direction) {
+        Vector2 segment = {position.x * cellSize, position.y * cellSize};
+        Color eyeColor = white;
+        float eyeSize = cellSize * 0.15f;
+        float eyeOffset = cellSize * 0.25f;
+        
+        if (direction == DIR_RIGHT) {
+            DrawCircle((int)(segment.x + cellSize - eyeOffset), (int)(segment.y + eyeOffset), eyeSize, eyeColor);
+            DrawCircle((int)(segment.x + cellSize - eyeOffset), (int)(segment.y + cellSize - eyeOffset), eyeSize, eyeColor);
+        } else if (direction == DIR_LEFT) {
+            DrawCircle((int)(segment.x + eyeOffset), (int)(segment.y + eyeOffset), eyeSize, eyeColor);
+            DrawCircle((int)(segment.x + eyeOffset), (int)(segment.y + cellSize - eyeOffset), eyeSize, eyeColor);
+        } else if (direction == DIR_UP) {
+            DrawCircle((int)(segment.x + eyeOffset), (int)(segment.y + eyeOffset), eyeSize, eyeColor);
+            DrawCircle((int)(segment.x + cellSize - eyeOffset), (int)(segment.y + eyeOffset), eyeSize, eyeColor);
         } else {
-            body.pop_back();
+            DrawCircle((int)(segment.x + eyeOffset), (int)(segment.y + cellSize - eyeOffset), eyeSize, eyeColor);
+            DrawCircle((int)(segment.x + cellSize - eyeOffset), (int)(segment.y + cellSize - eyeOffset), eyeSize, eyeColor);
         }
     }
 
-    void Reset() {
-        int startX = cellCount / 4;
-        int startY = cellCount / 2;
-        body = {Vector2{(float)startX + 2, (float)startY}, 
-                Vector2{(float)startX + 1, (float)startY}, 
-                Vector2{(float)startX, (float)startY}};
-        direction = {1, 0};
+private:
+    void BeginQuads(Color color) {
+        rlSetTexture(segmentTexture.texture.id);
+        runColor = color;
+        OpenRun();
+    }
+
+    void OpenRun() {
+        quadsInRun = 0;
+        rlCheckRenderBatchLimit(4 * QUADS_PER_RUN);
+        rlBegin(RL_QUADS);
+        rlColor4ub(runColor.r, runColor.g, runColor.b, runColor.a);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+    }
+
+    void AddSegment(Vector2 position) {
+        if (quadsInRun == QUADS_PER_RUN) {
+            // Start a new run so the batch never overflows mid-primitive.
+            rlEnd();
+            profiler.CountDraws(1);
+            OpenRun();
+        }
+        float size = (float)cellSize;
+        float left = position.x * size;
+        float top = position.y * size;
+        // Render textures are stored upside down, hence the flipped v.
+        rlTexCoord2f(0.0f, 1.0f); rlVertex2f(left, top);
+        rlTexCoord2f(0.0f, 0.0f); rlVertex2f(left, top + size);
+        rlTexCoord2f(1.0f, 0.0f); rlVertex2f(left + size, top + size);
+        rlTexCoord2f(1.0f, 1.0f); rlVertex2f(left + size, top);
+        quadsInRun++;
+    }
+
+    void EndQuads() {
+        rlEnd();
+        rlSetTexture(0);
+        profiler.CountDraws(1);
+    }
+
+    // Rebuilds the spatial index after anything other than single steps
+    // (a new game, a replay seek) and sizes the LOD texture for the board.
+    void Track(const Simulation& sim) {
+        int n = sim.config.cellCount;
+        if (!indexed || trackedCells != n) {
+            serials.assign((size_t)n * n, 0);
+            lodBlock = 1;
+            while ((n + lodBlock - 1) / lodBlock > MAX_LOD_TEXTURE) lodBlock *= 2;
+            lodSize = (n + lodBlock - 1) / lodBlock;
+            lodPixels.assign((size_t)lodSize * lodSize * 2, 255);
+            if (lodLoaded) {
+                UnloadTexture(lodTexture);
+                lodLoaded = false;
+            }
+            trackedCells = n;
+            indexed = true;
+            stale = true;
+        }
+        if (!stale && sim.tick == trackedTick && sim.config.seed == trackedSeed) {
+            return;
+        }
+        // Serials only need to be right for cells the body covers now.
+        headSerial = (uint32_t)sim.body.Size();
+        for (int i = 0; i < sim.body.Size(); i++) {
+            serials[sim.body.IndexAt(i)] = headSerial - (uint32_t)i;
+        }
+        trackedTick = sim.tick;
+        trackedSeed = sim.config.seed;
+        changedCells.clear();
+        lodStale = true;
+        stale = false;
+    }
+
+    // Share of the block's cells covered by the body, as 0-255.
+    uint8_t BlockCoverage(const Simulation& sim, int bx, int by) const {
+        int n = sim.config.cellCount;
+        int covered = 0;
+        int total = 0;
+        for (int y = by * lodBlock; y < (by + 1) * lodBlock && y < n; y++) {
+            for (int x = bx * lodBlock; x < (bx + 1) * lodBlock && x < n; x++) {
+                covered += sim.occupied[(size_t)y * n + x];
+                total++;
+            }
+        }
+        return (uint8_t)(covered * 255 / total);
+    }
+
+    void DrawLod(const Simulation& sim, Color color) {
+        if (!lodLoaded) {
+            Image image = {lodPixels.data(), lodSize, lodSize, 1, PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA};
+            lodTexture = LoadTextureFromImage(image);
+            SetTextureFilter(lodTexture, TEXTURE_FILTER_BILINEAR);
+            lodLoaded = true;
+            lodStale = true;
+        }
+        if (lodStale) {
+            for (int by = 0; by < lodSize; by++) {
+                for (int bx = 0; bx < lodSize; bx++) {
+                    lodPixels[((size_t)by * lodSize + bx) * 2 + 1] = BlockCoverage(sim, bx, by);
+                }
+            }
+            UpdateTexture(lodTexture, lodPixels.data());
+            lodStale = false;
+        } else {
+            int n = sim.config.cellCount;
+            for (int cell : changedCells) {
+                int bx = (cell % n) / lodBlock;
+                int by = (cell / n) / lodBlock;
+                uint8_t* texel = &lodPixels[((size_t)by * lodSize + bx) * 2];
+                texel[1] = BlockCoverage(sim, bx, by);
+                UpdateTextureRec(lodTexture, Rectangle{(float)bx, (float)by, 1, 1}, texel);
+            }
+        }
+        changedCells.clear();
+
+        float size = (float)lodSize * lodBlock * cellSize;
+        DrawTexturePro(lodTexture, Rectangle{0, 0, (float)lodSize, (float)lodSize},
+                       Rectangle{0, 0, size, size}, Vector2{0, 0}, 0.0f, color);
+        profiler.CountDraws(1);
     }
 };
 
 class Apple {
 public:
-    Vector2 position;
     Texture2D texture;
     bool textureLoaded;
+    Image pending = {};
+    bool pendingOwned = false;
 
-    Apple(deque<Vector2> snakeBody) {
+    Apple() {
         textureLoaded = false;
-        position = GenerateRandomPosition(snakeBody);
     }
 
-    void LoadTexture() {
-        if (!textureLoaded) {
-            Image image = LoadImage("Graphics/apple.png");
-            if (image.data != nullptr) {
-                ImageResize(&image, cellSize, cellSize);
-                texture = LoadTextureFromImage(image);
-                UnloadImage(image);
-                textureLoaded = true;
+    // Builds the apple image at cellSize; safe to call off the main thread.
+    // Packed apples are already decoded at that size and are used straight
+    // from the mapped pack. Without a pack, or if it was built for another
+    // cell size, the image is decoded and resized here; so is it when the
+    // packed entry does not hold the image it describes.
+    void PrepareTexture() {
+        AssetEntry entry;
+        Image packed = {};
+        if (assetPack.Find("Graphics/apple.png", entry) && entry.kind == ASSET_IMAGE) {
+            packed.data = (void*)entry.data;
+            packed.width = (int)entry.params[0];
+            packed.height = (int)entry.params[1];
+            packed.format = (int)entry.params[2];
+            packed.mipmaps = (int)entry.params[3];
+        }
+        // The pack only checks that entries fit in the file; the upload reads
+        // the pixels straight from the mapping, so they must fit the entry.
+        bool usable = packed.data != nullptr && packed.width > 0 && packed.width <= 4096 && packed.height > 0 &&
+                      packed.height <= 4096 && packed.mipmaps == 1 &&
+                      packed.format >= PIXELFORMAT_UNCOMPRESSED_GRAYSCALE &&
+                      packed.format < PIXELFORMAT_COMPRESSED_DXT1_RGB &&
+                      entry.size >= (uint64_t)GetPixelDataSize(packed.width, packed.height, packed.format);
+        if (usable) {
+            if (packed.width == cellSize && packed.height == cellSize) {
+                pending = packed;
+                pendingOwned = false;
+                return;
             }
+            pending = ImageCopy(packed);
+        } else {
+            pending = LoadImage("Graphics/apple.png");
+        }
+        pendingOwned = pending.data != nullptr;
+        if (pendingOwned) {
+            ImageResize(&pending, cellSize, cellSize);
         }
     }
 
+    // Main thread only: sends the prepared image to the GPU. Until then the
+    // apple is drawn as a circle.
+    void UploadTexture() {
+        if (!textureLoaded && pending.data != nullptr) {
+            texture = LoadTextureFromImage(pending);
+            textureLoaded = texture.id != 0;
+        }
+        if (pendingOwned) {
+            UnloadImage(pending);
+        }
+        pending = Image{};
+        pendingOwned = false;
+    }
+
     ~Apple() {
         if (textureLoaded) {
             UnloadTexture(texture);
         }
     }
 
-    void Draw() {
-        int offsetX = GetGameOffsetX();
-        int offsetY = GetGameOffsetY();
+    // Drawn in board world units. Zoomed far out the apple would vanish, so
+    // it becomes a dot a few pixels across instead.
+    void Draw(Cell position, const BoardCamera& view) {
+        float x = (float)(position.x * cellSize);
+        float y = (float)(position.y * cellSize);
         
-        if (textureLoaded) {
-            DrawTexture(texture, 
-                       (int)(offsetX + position.x * cellSize), 
-                       (int)(offsetY + position.y * cellSize), 
-                       WHITE);
+        if (view.cellPixels >= Snake::LOD_CELL_PIXELS * 4 && textureLoaded) {
+            DrawTexture(texture, (int)x, (int)y, WHITE);
+        } else if (view.cellPixels >= Snake::LOD_CELL_PIXELS * 4) {
+            DrawCircle((int)x + cellSize/2, (int)y + cellSize/2, cellSize/2 - 2, red);
         } else {
-            DrawCircle((int)(offsetX + position.x * cellSize + cellSize/2),
-                      (int)(offsetY + position.y * cellSize + cellSize/2),
-                      cellSize/2 - 2, red);
+            float radius = 3.0f * cellSize / view.cellPixels;
+            DrawCircleV(Vector2{x + cellSize / 2.0f, y + cellSize / 2.0f}, radius, red);
         }
-    }
-
-    Vector2 GenerateRandomCell() {
-        float x = (float)GetRandomValue(0, cellCount - 1);
-        float y = (float)GetRandomValue(0, cellCount - 1);
-        return Vector2{x, y};
-    }
-
-    Vector2 GenerateRandomPosition(deque<Vector2> snakeBody) {
-        Vector2 pos = GenerateRandomCell();
-        while (ElementInDeque(pos, snakeBody)) {
-            pos = GenerateRandomCell();
-        }
-        return pos;
+        profiler.CountDraws(1);
     }
 };
 
+// Renders a Simulation and ties it to the window-side state (pause, high
+// score, screen transitions). All game rules live in simulation.h.
+//
+// Every game is recorded and written to last_game.snkr when it ends. With
+// playback set, inputs come from a replay instead of the keyboard.
 class Game {
 public:
+    Simulation sim;
+    ReplayWriter replay;
+    ReplayPlayer* playback = nullptr;
     Snake snake = Snake();
-    Apple apple = Apple(snake.body);
+    Apple apple = Apple();
+    BoardCamera camera;
+    // While on, main steers with pilot's choice every tick.
+    Autopilot pilot;
+    bool autopilot = false;
+    Rng seeds = Rng((uint64_t)chrono::steady_clock::now().time_since_epoch().count());
+    // Turns waiting for their tick; Update takes one per tick.
+    InputQueue inputs;
+    // When set, every queued turn a tick applies is reported to it.
+    LatencyTracker* latency = nullptr;
+    // Off for games that are not really played (the latency test), which
+    // leave the leaderboard and last_game.snkr alone.
+    bool saveResults = true;
     bool running = true;
     bool pause = false;
-    int score = 0;
     int highScore = 0;
+    // Leaderboard the current game counts towards, fixed when it starts,
+    // and whether it has been entered yet.
+    uint32_t board = 0;
+    bool submitted = false;
 
-    void Draw() {
-        apple.Draw();
-        snake.Draw();
+    void Draw(float alpha = 1.0f) {
+        camera.Update(sim, snake.SegmentPosition(sim, 0, alpha));
+        Rectangle view = camera.View();
+        BeginScissorMode((int)view.x, (int)view.y, (int)view.width, (int)view.height);
+        BeginMode2D(camera.camera);
+        if (!sim.won) {
+            apple.Draw(sim.apple, camera);
+        }
+        snake.Draw(sim, alpha, camera);
+        EndMode2D();
+        EndScissorMode();
     }
 
     void Update() {
         if (running && !pause) {
-            snake.Update();
-            CheckCollisionWithFood();
-            CheckCollisionWithEdges();
-            CheckCollisionWithTail();
-        }
-    }
-
-    void CheckCollisionWithFood() {
-        if (Vector2Equals(snake.body[0], apple.position)) {
-            apple.position = apple.GenerateRandomPosition(snake.body);
-            snake.addSegment = true;
-            score++;
-            if (score > highScore) {
-                highScore = score;
-                SaveHighScore(highScore);
+            InputEvent event;
+            bool turned = inputs.Pop(event);
+            Direction dir = turned ? event.direction : DIR_NONE;
+            if (playback != nullptr) {
+                dir = playback->InputFor(sim.tick);
+            } else {
+                replay.Record(sim, dir);
             }
-        }
-    }
-
-    void CheckCollisionWithEdges() {
-        Vector2 head = snake.body[0];
-        
-        if (gameSettings.wallsEnabled) {
-            if (head.x >= cellCount || head.x < 0 || head.y >= cellCount || head.y < 0) {
-                GameOver();
+            StepResult result = sim.Step(dir);
+            snake.OnStep(sim);
+            if (turned && latency != nullptr && playback == nullptr) {
+                latency->Applied(event.time, ProfileNow());
             }
-        } else {
-            if (head.x >= cellCount) {
-                snake.body[0].x = 0;
-            } else if (head.x < 0) {
-                snake.body[0].x = (float)(cellCount - 1);
+            if (sim.score > highScore) {
+                highScore = sim.score;
             }
-            if (head.y >= cellCount) {
-                snake.body[0].y = 0;
-            } else if (head.y < 0) {
-                snake.body[0].y = (float)(cellCount - 1);
+            if (result == STEP_DIED || result == STEP_WON) {
+                GameOver();
             }
         }
     }
 
+    // Queues a turn behind any already waiting; time is when the key was
+    // read. Returns false for reversals and repeats of the last queued turn
+    // (see InputQueue), and when the queue is full.
+    bool Steer(Direction dir, uint64_t time = ProfileNow()) {
+        if (!inputs.Push(dir, time, sim.direction)) {
+            return false;
+        }
+        running = true;
+        return true;
+    }
+
     void GameOver() {
         running = false;
         currentState = GAME_OVER;
+        if (playback == nullptr && saveResults) {
+            replay.Finish(sim);
+            fileWriter.Write("last_game.snkr", replay.data);
+        }
+        Submit();
     }
 
-    void CheckCollisionWithTail() {
-        deque<Vector2> headlessBody = snake.body;
-        headlessBody.pop_front();
-        if (ElementInDeque(snake.body[0], headlessBody)) {
-            GameOver();
+    // Enters the current game on its leaderboard, once. Games left part way
+    // count too, as long as something was eaten.
+    void Submit() {
+        if (submitted || playback != nullptr || !saveResults || sim.score == 0) {
+            return;
         }
+        LeaderboardEntry entry;
+        entry.score = sim.score;
+        entry.ticks = (uint32_t)sim.tick;
+        entry.timestamp = (int64_t)time(nullptr);
+        leaderboard.Add(board, entry);
+        submitted = true;
     }
 
+    void BeginBoard() {
+        board = gameSettings.GetBoardKey();
+        highScore = leaderboard.Best(board);
+        submitted = false;
+    }
+
+    // Starts a new game, or restarts the replay being played back. Settings
+    // only change between games, so a recording is always reproducible.
     void Reset() {
-        snake.Reset();
-        apple.position = apple.GenerateRandomPosition(snake.body);
+        Submit();
+        if (playback != nullptr) {
+            playback->Start(*playback->replay, sim);
+        } else {
+            sim.config.wallsEnabled = gameSettings.wallsEnabled;
+            sim.Reset(seeds.Next());
+            replay.Begin(sim.config);
+        }
+        BeginBoard();
+        camera.Reset(sim);
+        inputs.Clear();
         running = true;
         pause = false;
-        score = 0;
     }
 
     void ApplySettings() {
+        Submit();
         cellCount = gameSettings.GetCellCount();
-        snake.Reset();
-        apple.position = apple.GenerateRandomPosition(snake.body);
+        SimConfig config;
+        config.cellCount = cellCount;
+        config.wallsEnabled = gameSettings.wallsEnabled;
+        config.seed = seeds.Next();
+        sim.Configure(config);
+        replay.Begin(sim.config);
+        BeginBoard();
+        camera.Reset(sim);
+        inputs.Clear();
     }
 };
@@ -1,5 +1,6 @@
 #include "globals.h"
-#include <deque>
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 
 Color yellow = {255, 184, 35, 255};
@@ -27,8 +28,7 @@ int offset = 75;
 
 const int WINDOW_WIDTH = 1100;
 const int WINDOW_HEIGHT = 950;
-
-double lastUpdateTime = 0;
+const int MAX_BOARD_VIEW = 750;
 
 Settings gameSettings;
 
@@ -56,6 +56,9 @@ Color Settings::GetBackgroundColor() const {
 }
 
 double Settings::GetGameSpeed() const {
+    if (tickRate > 0) {
+        return 1.0 / tickRate;
+    }
     switch(difficulty) {
         case EASY: return 0.4;
         case NORMAL: return 0.25;
@@ -69,6 +72,9 @@ int Settings::GetCellCount() const {
         case SMALL: return 15;
         case MEDIUM: return 20;
         case LARGE: return 25;
+        case HUGE_256: return 256;
+        case HUGE_1024: return 1024;
+        case HUGE_4096: return 4096;
         default: return 20;
     }
 }
@@ -87,6 +93,7 @@ const char* Settings::GetGridSizeName() const {
         case SMALL: return "Small";
         case MEDIUM: return "Medium";
         case LARGE: return "Large";
+        case HUGE_256: case HUGE_1024: case HUGE_4096: return "Huge";
         default: return "Medium";
     }
 }
@@ -99,52 +106,63 @@ const char* Settings::GetControlsName() const {
     }
 }
 
+uint32_t Settings::GetBoardKey() const {
+    return ((uint32_t)difficulty << 24) | ((uint32_t)gridSize << 16) |
+           ((uint32_t)wallsEnabled << 8) | (uint32_t)controls;
+}
+
+// Side of the square screen area the board is drawn in.
+int GetBoardViewSize() {
+    long long boardSize = (long long)cellSize * cellCount;
+    return boardSize < MAX_BOARD_VIEW ? (int)boardSize : MAX_BOARD_VIEW;
+}
+
 int GetGameOffsetX() {
-    int gameAreaWidth = cellSize * cellCount;
-    return (WINDOW_WIDTH - gameAreaWidth) / 2;
+    return (WINDOW_WIDTH - GetBoardViewSize()) / 2;
 }
 
 int GetGameOffsetY() {
-    int gameAreaHeight = cellSize * cellCount;
-    return (WINDOW_HEIGHT - gameAreaHeight) / 2 + 20;
+    return (WINDOW_HEIGHT - GetBoardViewSize()) / 2 + 20;
 }
 
-bool eventTriggered(double interval) {
-    double currentTime = GetTime();
-    if (currentTime - lastUpdateTime >= interval) {
-        lastUpdateTime = currentTime;
-        return true;
-    }
-    return false;
+void FixedTimestep::Reset(double now) {
+    accumulator = 0;
+    lastTime = now;
 }
 
-bool ElementInDeque(Vector2 element, std::deque<Vector2>& deque) {
-    for (size_t i = 0; i < deque.size(); i++) {
-        if (deque[i].x == element.x && deque[i].y == element.y) {
-            return true;
-        }
+// Returns how many ticks to run this frame. Long stalls are clamped to
+// maxFrameTime, so catching up after a hitch is bounded by time; the tick
+// cap scales with the interval to match, so a steady tick rate well above
+// the frame rate never sheds ticks.
+int FixedTimestep::Advance(double now, double interval) {
+    if (lastTime < 0) {
+        lastTime = now;
     }
-    return false;
-}
+    double frameTime = now - lastTime;
+    lastTime = now;
+    if (frameTime > maxFrameTime) {
+        frameTime = maxFrameTime;
+    }
+    accumulator += frameTime;
 
-int LoadHighScore() {
-    int highScore = 0;
-    FILE* file = fopen("highscore.dat", "r");
-    if (file != NULL) {
-        fscanf(file, "%d", &highScore);
-        fclose(file);
+    int maxTicks = std::max(maxTicksPerFrame, (int)std::ceil(maxFrameTime / interval));
+    int ticks = (int)(accumulator / interval);
+    if (ticks > maxTicks) {
+        ticks = maxTicks;
+        accumulator = interval * maxTicks;
     }
-    return highScore;
+    accumulator -= ticks * interval;
+    return ticks;
 }
 
-void SaveHighScore(int score) {
-    FILE* file = fopen("highscore.dat", "w");
-    if (file != NULL) {
-        fprintf(file, "%d", score);
-        fclose(file);
-    }
+// How far the clock is into the next tick, in [0, 1).
+float FixedTimestep::Alpha(double interval) const {
+    float alpha = (float)(accumulator / interval);
+    return alpha < 0 ? 0 : (alpha > 1 ? 1 : alpha);
 }
 
-void DeleteHighScore() {
-    remove("highscore.dat");
+// Seconds from now until the next tick falls due.
+double FixedTimestep::Remaining(double now, double interval) const {
+    double remaining = interval - accumulator - (now - lastTime);
+    return remaining > 0 ? remaining : 0;
 }
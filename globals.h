@@ -2,7 +2,7 @@
 #define GLOBALS_H
 
 #include <raylib.h>
-#include <deque>
+#include <cstdint>
 
 extern Color yellow;
 extern Color darkGreen;
@@ -37,7 +37,10 @@ enum Difficulty {
 enum GridSize {
     SMALL,
     MEDIUM,
-    LARGE
+    LARGE,
+    HUGE_256,
+    HUGE_1024,
+    HUGE_4096
 };
 
 enum ControlScheme {
@@ -54,8 +57,8 @@ extern int offset;
 
 extern const int WINDOW_WIDTH;
 extern const int WINDOW_HEIGHT;
-
-extern double lastUpdateTime;
+// Largest on-screen board area; bigger boards scroll under a camera.
+extern const int MAX_BOARD_VIEW;
 
 struct Settings {
     Difficulty difficulty = NORMAL;
@@ -65,6 +68,7 @@ struct Settings {
     int snakeColorIndex = 0;
     int backgroundColorIndex = 0;
     ControlScheme controls = ARROW_KEYS;
+    double tickRate = 0;
     
     Color snakeColors[6];
     const char* snakeColorNames[6] = {"Green", "Blue", "Purple", "Red", "Orange", "Cyan"};
@@ -81,17 +85,31 @@ struct Settings {
     const char* GetDifficultyName() const;
     const char* GetGridSizeName() const;
     const char* GetControlsName() const;
+    // Identifies the leaderboard for the current difficulty, grid size,
+    // walls and controls.
+    uint32_t GetBoardKey() const;
 };
 
 extern Settings gameSettings;
 
+// Fixed-timestep clock for the simulation. Frame time is accumulated and
+// spent in whole ticks, so the tick rate stays exact whatever the frame rate,
+// and several ticks can run in one frame after a hitch.
+struct FixedTimestep {
+    double accumulator = 0;
+    double lastTime = -1;
+    // The least the per-frame tick cap can be; see Advance.
+    int maxTicksPerFrame = 4;
+    double maxFrameTime = 0.25;
+
+    void Reset(double now);
+    int Advance(double now, double interval);
+    float Alpha(double interval) const;
+    double Remaining(double now, double interval) const;
+};
+
+int GetBoardViewSize();
 int GetGameOffsetX();
 int GetGameOffsetY();
-bool eventTriggered(double interval);
-bool ElementInDeque(Vector2 element, std::deque<Vector2>& deque);
-
-int LoadHighScore();
-void SaveHighScore(int score);
-void DeleteHighScore();
 
 #endif
@@ -0,0 +1,377 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+#include "batch_simulation.h"
+#include "bots.h"
+#include "replay.h"
+
+// Runs the game rules with no window or audio device, driven by a simple
+// random bot. Useful for soak tests and measuring raw simulation throughput.
+//
+//   snake_headless [--ticks N] [--grid N] [--walls 0|1] [--seed N] [--batch N]
+//
+// With --batch N, N games are stepped in lockstep by BatchSimulation and
+// --ticks counts game-ticks across all of them.
+//
+//   snake_headless --record FILE [--bot random|greedy|autopilot] [--grid N] [--seed N]
+//   snake_headless --play FILE [--seek TICK]
+//   snake_headless --check-damaged FILE
+//
+// --record plays one game with the bot and saves its replay. --play replays
+// a file to the end (or to TICK), checking that seeking through keyframes
+// lands on the same states as playing straight through. --check-damaged
+// takes a good replay with keyframes, writes copies of it with known kinds of
+// damage to FILE.damaged and checks that each is refused by Open or Seek.
+
+using namespace std;
+
+struct HeadlessOptions {
+    long long ticks = 10000000;
+    int cellCount = 20;
+    bool wallsEnabled = true;
+    uint64_t seed = 1;
+    int batch = 0;
+    BotFunction bot = RandomBot;
+    const char* recordPath = nullptr;
+    const char* playPath = nullptr;
+    const char* damagedPath = nullptr;
+    long long seekTick = -1;
+};
+
+static bool ParseOptions(int argc, char** argv, HeadlessOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+        if (strcmp(arg, "--ticks") == 0) {
+            options.ticks = atoll(value);
+        } else if (strcmp(arg, "--grid") == 0) {
+            options.cellCount = atoi(value);
+        } else if (strcmp(arg, "--walls") == 0) {
+            options.wallsEnabled = atoi(value) != 0;
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = strtoull(value, nullptr, 10);
+        } else if (strcmp(arg, "--batch") == 0) {
+            options.batch = atoi(value);
+        } else if (strcmp(arg, "--bot") == 0) {
+            options.bot = FindBot(value);
+            if (options.bot == nullptr) {
+                fprintf(stderr, "Unknown bot '%s'\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--record") == 0) {
+            options.recordPath = value;
+        } else if (strcmp(arg, "--play") == 0) {
+            options.playPath = value;
+        } else if (strcmp(arg, "--check-damaged") == 0) {
+            options.damagedPath = value;
+        } else if (strcmp(arg, "--seek") == 0) {
+            options.seekTick = atoll(value);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+    if (options.cellCount < 4 || (long long)options.cellCount * options.cellCount > SnakeBody::MAX_CELLS) {
+        fprintf(stderr, "--grid must be between 4 and 4096\n");
+        return false;
+    }
+    if (options.batch > 0 && options.cellCount * options.cellCount > BatchSimulation::MAX_CELLS) {
+        fprintf(stderr, "--batch supports grids up to 256\n");
+        return false;
+    }
+    return true;
+}
+
+static int RecordGame(const HeadlessOptions& options) {
+    SimConfig config;
+    config.cellCount = options.cellCount;
+    config.wallsEnabled = options.wallsEnabled;
+    config.seed = options.seed;
+
+    Simulation sim(config);
+    Rng botRng(options.seed ^ 0x5DEECE66Dull);
+    ReplayWriter writer;
+    writer.Begin(sim.config);
+    while (sim.alive && (long long)sim.tick < options.ticks) {
+        Direction input = options.bot(sim, botRng);
+        writer.Record(sim, input);
+        sim.Step(input);
+    }
+    writer.Finish(sim);
+    if (!writer.Save(options.recordPath)) {
+        fprintf(stderr, "Could not write %s\n", options.recordPath);
+        return 1;
+    }
+    printf("recorded %llu ticks, score %d, %zu bytes, %zu keyframes\n",
+           (unsigned long long)sim.tick, sim.score, writer.data.size(), writer.keyframeOffsets.size());
+    return 0;
+}
+
+static bool SameState(const Simulation& a, const Simulation& b) {
+    if (a.tick != b.tick || a.score != b.score || a.alive != b.alive || a.apple != b.apple ||
+        a.direction != b.direction || a.rng.state != b.rng.state || a.body.Size() != b.body.Size()) {
+        return false;
+    }
+    for (int i = 0; i < a.body.Size(); i++) {
+        if (a.body.IndexAt(i) != b.body.IndexAt(i)) return false;
+    }
+    return a.freeCells.cells == b.freeCells.cells;
+}
+
+static int PlayReplay(const HeadlessOptions& options) {
+    ReplayFile file;
+    if (!file.Open(options.playPath)) {
+        fprintf(stderr, "Could not open replay %s\n", options.playPath);
+        return 1;
+    }
+
+    Simulation sim;
+    ReplayPlayer player;
+    player.Start(file, sim);
+    if (options.seekTick >= 0) {
+        auto start = chrono::steady_clock::now();
+        bool ok = player.Seek(sim, (uint64_t)options.seekTick);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        printf("seek to %lld: %s in %.3f ms, tick %llu, score %d, length %d\n", options.seekTick,
+               ok ? "ok" : "failed", ms, (unsigned long long)sim.tick, sim.score, sim.body.Size());
+        return ok ? 0 : 1;
+    }
+
+    // Play straight through, and at every tick also check a seek from the
+    // nearest keyframe for a sample of ticks.
+    Simulation seeker;
+    ReplayPlayer seekPlayer;
+    seekPlayer.Start(file, seeker);
+    int mismatches = 0;
+    int checks = 0;
+    Rng sample(options.seed);
+    while (sim.alive && !player.ended) {
+        // Without keyframes every seek replays from the start, so skip the
+        // checks rather than go quadratic.
+        if (file.keyframeCount > 0 && sample.Below(16) == 0) {
+            checks++;
+            if (!seekPlayer.Seek(seeker, sim.tick) || !SameState(sim, seeker)) {
+                mismatches++;
+            }
+        }
+        player.Step(sim);
+    }
+    player.InputFor(sim.tick);
+
+    bool endMatches = !player.ended || player.endTick == sim.tick;
+    printf("played %llu ticks, score %d, %s\n", (unsigned long long)sim.tick, sim.score,
+           sim.won ? "won" : (sim.alive ? "still alive" : "died"));
+    printf("seek checks: %d, mismatches: %d, end tick %s\n", checks, mismatches,
+           endMatches ? "matches" : "differs");
+    return mismatches == 0 && endMatches && player.cursor.ok ? 0 : 1;
+}
+
+static void PutLE(vector<uint8_t>& data, size_t at, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) data[at + i] = (uint8_t)(value >> (8 * i));
+}
+
+// Opens data as a replay and seeks to its first keyframe; true if both
+// succeed.
+static bool LoadsAndSeeks(const vector<uint8_t>& data, const string& path) {
+    FILE* out = fopen(path.c_str(), "wb");
+    if (out == nullptr) {
+        return false;
+    }
+    fwrite(data.data(), 1, data.size(), out);
+    fclose(out);
+    ReplayFile file;
+    if (!file.Open(path.c_str())) {
+        return false;
+    }
+    Simulation sim;
+    ReplayPlayer player;
+    player.Start(file, sim);
+    return player.Seek(sim, 0);
+}
+
+static int CheckDamagedReplays(const HeadlessOptions& options) {
+    vector<uint8_t> good;
+    size_t firstKeyframe = 0;
+    {
+        ReplayFile file;
+        if (!file.Open(options.damagedPath) || file.keyframeCount == 0) {
+            fprintf(stderr, "%s is not a replay with keyframes\n", options.damagedPath);
+            return 1;
+        }
+        good.assign(file.file.data, file.file.data + file.file.size);
+        firstKeyframe = (size_t)file.KeyframeOffset(0);
+    }
+    string path = string(options.damagedPath) + ".damaged";
+
+    // Where the first keyframe's fields are, by walking its layout.
+    ReplayCursor cursor = {good.data(), good.size(), firstKeyframe, true};
+    cursor.U8();
+    cursor.Varint();
+    cursor.Varint();
+    size_t directionAt = cursor.position;
+    cursor.position += 2;
+    cursor.Varint();
+    cursor.position += 8;
+    size_t appleAt = cursor.position;
+    size_t vacatedAt = appleAt + 4;
+    cursor.position += 8;
+    cursor.Varint();
+    size_t firstCellAt = cursor.position;
+    int cellBytes = good[6];
+    size_t trailerAt = good.size() - REPLAY_TRAILER_SIZE;
+
+    struct Damage {
+        const char* name;
+        void (*apply)(vector<uint8_t>& data, size_t at, int cellBytes);
+        size_t at;
+    };
+    const Damage damages[] = {
+        {"grid of 60000", [](vector<uint8_t>& d, size_t, int) { PutLE(d, 8, 60000, 4); }, 0},
+        {"grid of 2", [](vector<uint8_t>& d, size_t, int) { PutLE(d, 8, 2, 4); }, 0},
+        {"2-byte cells on a 300 grid", [](vector<uint8_t>& d, size_t, int) { d[6] = 2; PutLE(d, 8, 300, 4); }, 0},
+        {"index offset that wraps", [](vector<uint8_t>& d, size_t at, int) {
+            PutLE(d, at + 8, 0x10000000, 4);
+            PutLE(d, at, (uint64_t)at - 0x80000000ull, 8);
+        }, trailerAt},
+        {"index past the trailer", [](vector<uint8_t>& d, size_t at, int) { PutLE(d, at, at + 8, 8); }, trailerAt},
+        {"index inside the header", [](vector<uint8_t>& d, size_t at, int) { PutLE(d, at, 0, 8); }, trailerAt},
+        {"direction out of range", [](vector<uint8_t>& d, size_t at, int) { d[at] = 9; }, directionAt},
+        {"no direction", [](vector<uint8_t>& d, size_t at, int) { d[at] = DIR_NONE; }, directionAt},
+        {"apple off the board", [](vector<uint8_t>& d, size_t at, int) { PutLE(d, at, 0x7FFFFFFF, 4); }, appleAt},
+        {"vacated tail off the board", [](vector<uint8_t>& d, size_t at, int) { PutLE(d, at, 0x7FFFFFFF, 4); },
+         vacatedAt},
+        {"vacated tail below -1", [](vector<uint8_t>& d, size_t at, int) { PutLE(d, at, 0xFFFFFFFE, 4); },
+         vacatedAt},
+        {"body cell twice", [](vector<uint8_t>& d, size_t at, int bytes) {
+            for (int i = 0; i < bytes; i++) d[at + bytes + i] = d[at + i];
+        }, firstCellAt},
+    };
+
+    int failures = 0;
+    if (!LoadsAndSeeks(good, path)) {
+        printf("  undamaged copy: refused\n");
+        failures++;
+    }
+    for (const Damage& damage : damages) {
+        vector<uint8_t> data = good;
+        damage.apply(data, damage.at, cellBytes);
+        bool refused = !LoadsAndSeeks(data, path);
+        printf("  %-28s %s\n", damage.name, refused ? "refused" : "ACCEPTED");
+        if (!refused) failures++;
+    }
+    remove(path.c_str());
+    printf("damaged replays: %d of %zu handled\n", (int)(sizeof(damages) / sizeof(damages[0])) + 1 - failures,
+           sizeof(damages) / sizeof(damages[0]) + 1);
+    return failures == 0 ? 0 : 1;
+}
+
+// Random actions are drawn up front so the timing covers stepping only.
+static int RunBatch(const HeadlessOptions& options) {
+    BatchSimulation batch;
+    batch.Init(options.batch, options.cellCount, options.wallsEnabled);
+    batch.Reset(options.seed);
+
+    const int actionRows = 64;
+    Rng rng(options.seed ^ 0x5DEECE66Dull);
+    vector<int32_t> actions((size_t)actionRows * options.batch);
+    for (size_t i = 0; i < actions.size(); i++) {
+        actions[i] = rng.Below(4) == 0 ? 1 + rng.Below(4) : DIR_NONE;
+    }
+
+    long long steps = (options.ticks + options.batch - 1) / options.batch;
+    long long games = 0;
+    long long wins = 0;
+    long long totalScore = 0;
+    int maxScore = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (long long t = 0; t < steps; t++) {
+        batch.StepBatch(&actions[(size_t)(t % actionRows) * options.batch]);
+        for (int g = 0; g < options.batch; g++) {
+            if (!batch.alive[g]) {
+                games++;
+                wins += batch.won[g];
+                totalScore += batch.score[g];
+                if (batch.score[g] > maxScore) maxScore = batch.score[g];
+                batch.ResetGame(g, rng.Next());
+            }
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long long ticks = steps * options.batch;
+
+    printf("batch:      %d games\n", options.batch);
+    printf("ticks:      %lld\n", ticks);
+    printf("games:      %lld\n", games);
+    printf("wins:       %lld\n", wins);
+    printf("mean score: %.2f\n", games > 0 ? (double)totalScore / games : 0.0);
+    printf("max score:  %d\n", maxScore);
+    printf("elapsed:    %.3f s\n", seconds);
+    printf("throughput: %.2f Mticks/s\n", ticks / seconds / 1e6);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    HeadlessOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+    if (options.batch > 0) {
+        return RunBatch(options);
+    }
+    if (options.recordPath != nullptr) {
+        return RecordGame(options);
+    }
+    if (options.playPath != nullptr) {
+        return PlayReplay(options);
+    }
+    if (options.damagedPath != nullptr) {
+        return CheckDamagedReplays(options);
+    }
+
+    SimConfig config;
+    config.cellCount = options.cellCount;
+    config.wallsEnabled = options.wallsEnabled;
+    config.seed = options.seed;
+
+    Simulation sim(config);
+    Rng botRng(options.seed ^ 0x5DEECE66Dull);
+    Rng seeds(options.seed);
+
+    long long games = 0;
+    long long wins = 0;
+    long long totalScore = 0;
+    int maxScore = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (long long t = 0; t < options.ticks; t++) {
+        StepResult result = sim.Step(options.bot(sim, botRng));
+        if (result == STEP_DIED || result == STEP_WON) {
+            games++;
+            if (result == STEP_WON) wins++;
+            totalScore += sim.score;
+            if (sim.score > maxScore) maxScore = sim.score;
+            sim.Reset(seeds.Next());
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    printf("ticks:      %lld\n", options.ticks);
+    printf("games:      %lld\n", games);
+    printf("wins:       %lld\n", wins);
+    printf("mean score: %.2f\n", games > 0 ? (double)totalScore / games : 0.0);
+    printf("max score:  %d\n", maxScore);
+    printf("elapsed:    %.3f s\n", seconds);
+    printf("throughput: %.2f Mticks/s\n", options.ticks / seconds / 1e6);
+    return 0;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+
+#include "raylib.h"
+#include "globals.h"
+#include "simulation.h"
+
+// Turning input. Key presses are read in the order they happened (raylib's
+// GetKeyPressed queue, not one IsKeyPressed check per key), mapped through
+// a binding table and queued with the time they were read. The simulation
+// takes one queued turn per tick, so two quick presses between ticks, such
+// as Up then Left for a tight turn, become two consecutive turns instead of
+// only the last one counting.
+
+struct InputEvent {
+    Direction direction;
+    // ProfileNow when the key was read.
+    uint64_t time;
+};
+
+// Keys to directions for one control scheme. Any key can be rebound with
+// Bind; a key bound twice keeps its latest direction.
+class InputBindings {
+public:
+    static const int MAX_BINDINGS = 16;
+
+    static InputBindings ForScheme(ControlScheme scheme) {
+        InputBindings bindings;
+        if (scheme == ARROW_KEYS) {
+            bindings.Bind(KEY_UP, DIR_UP);
+            bindings.Bind(KEY_DOWN, DIR_DOWN);
+            bindings.Bind(KEY_LEFT, DIR_LEFT);
+            bindings.Bind(KEY_RIGHT, DIR_RIGHT);
+        } else {
+            bindings.Bind(KEY_W, DIR_UP);
+            bindings.Bind(KEY_S, DIR_DOWN);
+            bindings.Bind(KEY_A, DIR_LEFT);
+            bindings.Bind(KEY_D, DIR_RIGHT);
+        }
+        return bindings;
+    }
+
+    // Binding to DIR_NONE removes the key. Returns false when the table is
+    // full.
+    bool Bind(int key, Direction direction) {
+        for (int i = 0; i < count; i++) {
+            if (keys[i] == key) {
+                if (direction == DIR_NONE) {
+                    count--;
+                    keys[i] = keys[count];
+                    directions[i] = directions[count];
+                } else {
+                    directions[i] = direction;
+                }
+                return true;
+            }
+        }
+        if (direction == DIR_NONE) {
+            return true;
+        }
+        if (count == MAX_BINDINGS) {
+            return false;
+        }
+        keys[count] = key;
+        directions[count] = direction;
+        count++;
+        return true;
+    }
+
+    Direction Lookup(int key) const {
+        for (int i = 0; i < count; i++) {
+            if (keys[i] == key) return directions[i];
+        }
+        return DIR_NONE;
+    }
+
+private:
+    int keys[MAX_BINDINGS];
+    Direction directions[MAX_BINDINGS];
+    int count = 0;
+};
+
+// Turns waiting for their tick, oldest first. Each is checked against the
+// one queued before it (or the current heading when none is), so a
+// reversal is refused even when the turn it would undo has not happened
+// yet, and repeating the last queued direction adds nothing. Bounded: a
+// turn more than CAPACITY ticks ahead would feel like lag, so it is dropped.
+class InputQueue {
+public:
+    static const int CAPACITY = 4;
+
+    bool Push(Direction direction, uint64_t time, Direction heading) {
+        Direction last = count > 0 ? events[(first + count - 1) % CAPACITY].direction : heading;
+        if (direction == DIR_NONE || direction == last || IsOppositeDirection(direction, last) ||
+            count == CAPACITY) {
+            return false;
+        }
+        events[(first + count) % CAPACITY] = InputEvent{direction, time};
+        count++;
+        return true;
+    }
+
+    bool Pop(InputEvent& event) {
+        if (count == 0) {
+            return false;
+        }
+        event = events[first];
+        first = (first + 1) % CAPACITY;
+        count--;
+        return true;
+    }
+
+    void Clear() {
+        first = 0;
+        count = 0;
+    }
+
+    int Size() const {
+        return count;
+    }
+
+private:
+    InputEvent events[CAPACITY];
+    int first = 0;
+    int count = 0;
+};
@@ -0,0 +1,215 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+// Input-to-display latency: how long from a turn being pressed until a frame
+// showing the snake turned has been presented. It is split into
+//   wait     press to the tick that applies it (frame poll delay plus the
+//            wait for the next tick)
+//   display  that tick to the end of the first frame presented after it
+//            (render, present and whatever the frame cap adds)
+// Samples are kept per configuration (difficulty and FPS cap, labelled by
+// the caller) in fixed histograms. Nothing in here depends on raylib.
+//
+// raylib reports key presses once per frame, so real presses are stamped
+// at the poll and their wait starts there. Synthetic presses (see
+// SyntheticTurns) carry the time they were scheduled for, so the test also
+// measures the poll delay.
+
+class LatencyHistogram {
+public:
+    static const int BUCKETS = 100;
+    static constexpr double BUCKET_MS = 5.0;
+
+    void Add(double ms) {
+        int bucket = (int)(ms / BUCKET_MS);
+        if (bucket < 0) bucket = 0;
+        if (bucket >= BUCKETS) bucket = BUCKETS;
+        counts[bucket]++;
+        count++;
+        total += ms;
+        if (ms > worst) worst = ms;
+    }
+
+    int Count() const {
+        return count;
+    }
+
+    double Mean() const {
+        return count > 0 ? total / count : 0.0;
+    }
+
+    double Max() const {
+        return worst;
+    }
+
+    // Upper edge of the bucket holding the p-th percentile.
+    double Percentile(double p) const {
+        int rank = (int)(p / 100.0 * count + 0.5);
+        if (rank < 1) rank = 1;
+        int seen = 0;
+        for (int i = 0; i <= BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) return i < BUCKETS ? (i + 1) * BUCKET_MS : worst;
+        }
+        return worst;
+    }
+
+    // One row per non-empty bucket, with a bar scaled to the fullest.
+    void Print(FILE* out) const {
+        int fullest = 1;
+        for (int i = 0; i <= BUCKETS; i++) {
+            if (counts[i] > fullest) fullest = counts[i];
+        }
+        for (int i = 0; i <= BUCKETS; i++) {
+            if (counts[i] == 0) continue;
+            char bar[41];
+            int width = counts[i] * 40 / fullest;
+            for (int c = 0; c < width; c++) bar[c] = '#';
+            bar[width] = '\0';
+            if (i < BUCKETS) {
+                fprintf(out, "      %4.0f-%4.0f ms %5d %s\n", i * BUCKET_MS, (i + 1) * BUCKET_MS, counts[i], bar);
+            } else {
+                fprintf(out, "      %4.0f+     ms %5d %s\n", BUCKETS * BUCKET_MS, counts[i], bar);
+            }
+        }
+    }
+
+private:
+    // The last bucket takes everything past the range.
+    int counts[BUCKETS + 1] = {};
+    int count = 0;
+    double total = 0.0;
+    double worst = 0.0;
+};
+
+class LatencyTracker {
+public:
+    // Later samples go under label until it is changed again.
+    void SetConfiguration(const std::string& label) {
+        current = -1;
+        for (size_t i = 0; i < configurations.size(); i++) {
+            if (configurations[i].label == label) current = (int)i;
+        }
+        if (current < 0) {
+            configurations.push_back(Configuration{label, {}, {}, {}});
+            current = (int)configurations.size() - 1;
+        }
+        applied.clear();
+    }
+
+    // A tick applied a turn pressed at inputTime.
+    void Applied(uint64_t inputTime, uint64_t tickTime) {
+        applied.push_back(Turn{inputTime, tickTime});
+    }
+
+    // A frame finished presenting; it is the first to show every turn
+    // applied since the last one.
+    void Presented(uint64_t presentTime) {
+        if (current < 0) {
+            applied.clear();
+            return;
+        }
+        Configuration& configuration = configurations[current];
+        for (const Turn& turn : applied) {
+            configuration.wait.Add(Ms(turn.tickTime - turn.inputTime));
+            configuration.display.Add(Ms(presentTime - turn.tickTime));
+            configuration.total.Add(Ms(presentTime - turn.inputTime));
+        }
+        applied.clear();
+    }
+
+    // Turns applied but not yet on screen.
+    int Pending() const {
+        return (int)applied.size();
+    }
+
+    int Samples() const {
+        return current < 0 ? 0 : configurations[current].total.Count();
+    }
+
+    void Report(FILE* out) const {
+        fprintf(out, "input-to-display latency (ms)\n");
+        for (const Configuration& configuration : configurations) {
+            const LatencyHistogram& total = configuration.total;
+            if (total.Count() == 0) continue;
+            fprintf(out, "  %s: %d turns, p50 %.0f, p90 %.0f, p99 %.0f, max %.1f, mean %.1f (wait %.1f + display %.1f)\n",
+                    configuration.label.c_str(), total.Count(), total.Percentile(50), total.Percentile(90),
+                    total.Percentile(99), total.Max(), total.Mean(), configuration.wait.Mean(),
+                    configuration.display.Mean());
+            total.Print(out);
+        }
+    }
+
+private:
+    struct Turn {
+        uint64_t inputTime;
+        uint64_t tickTime;
+    };
+
+    struct Configuration {
+        std::string label;
+        LatencyHistogram wait;
+        LatencyHistogram display;
+        LatencyHistogram total;
+    };
+
+    std::vector<Configuration> configurations;
+    std::vector<Turn> applied;
+    int current = -1;
+
+    static double Ms(uint64_t nanoseconds) {
+        return nanoseconds / 1e6;
+    }
+};
+
+// Presses for the latency test, one at a time: each is due a random time
+// after the previous one was shown, so presses land at every phase of the
+// tick and frame, and turns perpendicular to the heading so the snake
+// never reverses.
+class SyntheticTurns {
+public:
+    Rng rng = Rng(2024);
+
+    bool Armed() const {
+        return armed;
+    }
+
+    // The next press falls between half and one and a half tick intervals
+    // after now.
+    void Schedule(uint64_t now, double tickSeconds) {
+        double delay = tickSeconds * (0.5 + rng.Below(1000) / 1000.0);
+        due = now + (uint64_t)(delay * 1e9);
+        armed = true;
+    }
+
+    void Cancel() {
+        armed = false;
+    }
+
+    // True once the scheduled press time has passed; pressTime is that time.
+    bool Due(uint64_t now, uint64_t& pressTime) {
+        if (!armed || now < due) {
+            return false;
+        }
+        armed = false;
+        pressTime = due;
+        return true;
+    }
+
+    Direction Pick(Direction heading) {
+        bool vertical = heading == DIR_UP || heading == DIR_DOWN;
+        if (rng.Below(2) == 0) {
+            return vertical ? DIR_LEFT : DIR_UP;
+        }
+        return vertical ? DIR_RIGHT : DIR_DOWN;
+    }
+
+private:
+    uint64_t due = 0;
+    bool armed = false;
+};
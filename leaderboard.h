@@ -0,0 +1,215 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "file_writer.h"
+#include "mapped_file.h"
+
+// Best scores per board configuration (difficulty, grid size, walls and
+// controls; see Settings::GetBoardKey), kept in memory as a sorted top list
+// per board and stored as an append-only log of fixed-size records.
+//
+// Finishing a game appends one record through the background FileWriter.
+// Once the log holds many more records than the boards keep, it is
+// compacted: the kept entries are written out as a fresh log, which the
+// writer swaps in with an atomic rename. Appends queued behind that are
+// joined onto it, so nothing is lost. The log never holds much more than
+// what is kept, so loading it does not slow down as games pile up.
+//
+// Layout (little-endian):
+//   header   "SNKL", u32 version
+//   records  u32 board, i32 score, u32 ticks, i64 unix time, u32 check
+//
+// check is a hash of the other record fields. A crash during an append can
+// leave a torn record at the end; it fails the check and is skipped.
+
+static const uint32_t LEADERBOARD_MAGIC = 0x4C4B4E53;  // "SNKL"
+static const uint32_t LEADERBOARD_VERSION = 1;
+static const int LEADERBOARD_HEADER_SIZE = 8;
+static const int LEADERBOARD_RECORD_SIZE = 24;
+
+struct LeaderboardEntry {
+    int score = 0;
+    uint32_t ticks = 0;
+    int64_t timestamp = 0;
+};
+
+class Leaderboard {
+public:
+    // Entries kept per board.
+    static const int KEEP = 100;
+
+    // Reads the log at path and remembers path for later saves. A missing
+    // file is an empty leaderboard.
+    void Load(const char* path) {
+        this->path = path;
+        boards.clear();
+        logRecords = 0;
+        MappedFile file;
+        if (!file.Open(path) || file.size < (size_t)LEADERBOARD_HEADER_SIZE ||
+            Get(file.data, 4) != LEADERBOARD_MAGIC || Get(file.data + 4, 4) != LEADERBOARD_VERSION) {
+            return;
+        }
+        bool damaged = (file.size - LEADERBOARD_HEADER_SIZE) % LEADERBOARD_RECORD_SIZE != 0;
+        for (size_t offset = LEADERBOARD_HEADER_SIZE; offset + LEADERBOARD_RECORD_SIZE <= file.size;
+             offset += LEADERBOARD_RECORD_SIZE) {
+            const uint8_t* record = file.data + offset;
+            if ((uint32_t)Get(record + 20, 4) != Check(record)) {
+                damaged = true;
+                continue;
+            }
+            LeaderboardEntry entry;
+            uint32_t board = (uint32_t)Get(record, 4);
+            entry.score = (int32_t)Get(record + 4, 4);
+            entry.ticks = (uint32_t)Get(record + 8, 4);
+            entry.timestamp = (int64_t)Get(record + 12, 8);
+            Insert(board, entry);
+            logRecords++;
+        }
+        file.Close();
+        if (damaged) {
+            // Rewrite it so new records do not land after the torn bytes.
+            Compact();
+        }
+    }
+
+    // Records a finished game and queues it for saving. Returns its rank
+    // on the board (1 is best), or 0 if it did not make the list.
+    int Add(uint32_t board, const LeaderboardEntry& entry) {
+        int rank = Insert(board, entry);
+        if (path.empty()) {
+            return rank;
+        }
+        std::vector<uint8_t> bytes;
+        if (logRecords == 0) {
+            // A fresh log; replace anything unreadable that was there.
+            PutHeader(bytes);
+            PutRecord(bytes, board, entry);
+            fileWriter.Write(path, bytes);
+        } else {
+            PutRecord(bytes, board, entry);
+            fileWriter.Append(path, bytes);
+        }
+        logRecords++;
+        if (logRecords > 2 * Kept() + 256) {
+            Compact();
+        }
+        return rank;
+    }
+
+    // The rank score would get on board, 1 being best, in O(log KEEP).
+    // Ties rank below the scores already there.
+    int Rank(uint32_t board, int score) const {
+        auto found = boards.find(board);
+        if (found == boards.end()) {
+            return 1;
+        }
+        const std::vector<LeaderboardEntry>& top = found->second;
+        auto position = std::upper_bound(top.begin(), top.end(), score,
+                                         [](int value, const LeaderboardEntry& entry) { return value > entry.score; });
+        return (int)(position - top.begin()) + 1;
+    }
+
+    int Best(uint32_t board) const {
+        auto found = boards.find(board);
+        return found == boards.end() || found->second.empty() ? 0 : found->second.front().score;
+    }
+
+    // Best first.
+    const std::vector<LeaderboardEntry>& Top(uint32_t board) const {
+        static const std::vector<LeaderboardEntry> empty;
+        auto found = boards.find(board);
+        return found == boards.end() ? empty : found->second;
+    }
+
+    // Forgets every board and truncates the log.
+    void Clear() {
+        boards.clear();
+        logRecords = 0;
+        if (!path.empty()) {
+            std::vector<uint8_t> bytes;
+            PutHeader(bytes);
+            fileWriter.Write(path, bytes);
+        }
+    }
+
+private:
+    std::string path;
+    std::map<uint32_t, std::vector<LeaderboardEntry>> boards;
+    size_t logRecords = 0;
+
+    size_t Kept() const {
+        size_t total = 0;
+        for (const auto& board : boards) total += board.second.size();
+        return total;
+    }
+
+    // Higher scores first; among equal scores, the earlier game.
+    int Insert(uint32_t board, const LeaderboardEntry& entry) {
+        std::vector<LeaderboardEntry>& top = boards[board];
+        auto position = std::upper_bound(top.begin(), top.end(), entry,
+                                         [](const LeaderboardEntry& a, const LeaderboardEntry& b) {
+                                             if (a.score != b.score) return a.score > b.score;
+                                             return a.timestamp < b.timestamp;
+                                         });
+        int rank = (int)(position - top.begin()) + 1;
+        if (rank > KEEP) {
+            return 0;
+        }
+        top.insert(position, entry);
+        if ((int)top.size() > KEEP) {
+            top.pop_back();
+        }
+        return rank;
+    }
+
+    void Compact() {
+        std::vector<uint8_t> bytes;
+        PutHeader(bytes);
+        for (const auto& board : boards) {
+            for (const LeaderboardEntry& entry : board.second) {
+                PutRecord(bytes, board.first, entry);
+            }
+        }
+        logRecords = Kept();
+        fileWriter.Write(path, std::move(bytes));
+    }
+
+    static uint64_t Get(const uint8_t* data, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= (uint64_t)data[i] << (8 * i);
+        return value;
+    }
+
+    static void Put(std::vector<uint8_t>& data, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) data.push_back((uint8_t)(value >> (8 * i)));
+    }
+
+    // FNV-1a over the first 20 bytes of a record.
+    static uint32_t Check(const uint8_t* record) {
+        uint32_t hash = 2166136261u;
+        for (int i = 0; i < 20; i++) {
+            hash = (hash ^ record[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    static void PutHeader(std::vector<uint8_t>& data) {
+        Put(data, LEADERBOARD_MAGIC, 4);
+        Put(data, LEADERBOARD_VERSION, 4);
+    }
+
+    static void PutRecord(std::vector<uint8_t>& data, uint32_t board, const LeaderboardEntry& entry) {
+        size_t start = data.size();
+        Put(data, board, 4);
+        Put(data, (uint32_t)entry.score, 4);
+        Put(data, entry.ticks, 4);
+        Put(data, (uint64_t)entry.timestamp, 8);
+        Put(data, Check(&data[start]), 4);
+    }
+};
+
+inline Leaderboard leaderboard;
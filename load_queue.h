@@ -0,0 +1,191 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "profiler.h"
+
+// Startup loading off the main thread, so the first menu frame does not
+// wait for the audio device or any asset. Jobs run one at a time on a
+// single loader thread, most urgent first and in submission order within a
+// priority, so a job may rely on everything submitted before it at the same
+// or a higher priority having finished.
+//
+// A job has two halves: work runs on the loader thread (file reads,
+// decoding, audio), and the optional finish runs on the main thread from
+// Pump, for anything that needs the GL context such as texture uploads.
+// Callers check their own ready flags and draw a fallback until then.
+//
+// Each job's timings are kept for Report, which prints them against the
+// launch time together with the time to the first frame.
+
+enum LoadPriority {
+    LOAD_CRITICAL,
+    LOAD_HIGH,
+    LOAD_NORMAL,
+    LOAD_LOW
+};
+
+static const char* const LOAD_PRIORITY_NAMES[] = {"critical", "high", "normal", "low"};
+
+class LoadQueue {
+public:
+    struct Timing {
+        const char* name;
+        LoadPriority priority;
+        uint64_t queued = 0;
+        uint64_t started = 0;
+        uint64_t worked = 0;
+        uint64_t finished = 0;
+    };
+
+    LoadQueue() {}
+    LoadQueue(const LoadQueue&) = delete;
+    LoadQueue& operator=(const LoadQueue&) = delete;
+    ~LoadQueue() {
+        Stop();
+    }
+
+    void Submit(const char* name, LoadPriority priority, std::function<void()> work,
+                std::function<void()> finish = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Job job;
+        job.timing.name = name;
+        job.timing.priority = priority;
+        job.timing.queued = ProfileNow();
+        job.sequence = nextSequence++;
+        job.work = std::move(work);
+        job.finish = std::move(finish);
+        waiting.push_back(std::move(job));
+        outstanding++;
+        wake.notify_one();
+    }
+
+    // Starts the loader thread. Submitting the startup jobs first means the
+    // thread sees them all and picks the most urgent, rather than whichever
+    // happened to be queued first.
+    void Start() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!thread.joinable()) {
+            stopping = false;
+            thread = std::thread([this]() { Loop(); });
+        }
+    }
+
+    // Main thread, once per frame: runs the finish half of every job whose
+    // work is done.
+    void Pump() {
+        std::vector<Job> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (worked.empty()) {
+                return;
+            }
+            ready.swap(worked);
+        }
+        for (Job& job : ready) {
+            if (job.finish) job.finish();
+            job.timing.finished = ProfileNow();
+            std::lock_guard<std::mutex> lock(mutex);
+            timings.push_back(job.timing);
+            outstanding--;
+        }
+    }
+
+    // True once every submitted job has run both halves.
+    bool Done() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return outstanding == 0;
+    }
+
+    // Lets the job in progress finish, drops the rest and ends the thread.
+    // Their finish halves never run.
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            waiting.clear();
+            if (!thread.joinable()) {
+                worked.clear();
+                outstanding = 0;
+                return;
+            }
+            stopping = true;
+            wake.notify_all();
+        }
+        thread.join();
+        std::lock_guard<std::mutex> lock(mutex);
+        worked.clear();
+        outstanding = 0;
+    }
+
+    // Prints when the first frame was shown and when each job was ready,
+    // all relative to launch (ProfileNow values).
+    void Report(FILE* out, uint64_t launch, uint64_t firstFrame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t last = firstFrame;
+        for (const Timing& timing : timings) {
+            if (timing.finished > last) last = timing.finished;
+        }
+        fprintf(out, "startup: first frame %.1f ms, all assets %.1f ms\n", Ms(firstFrame - launch),
+                Ms(last - launch));
+        for (const Timing& timing : timings) {
+            fprintf(out, "  %-14s %-8s waited %7.1f ms, worked %7.1f ms, ready at %7.1f ms\n", timing.name,
+                    LOAD_PRIORITY_NAMES[timing.priority], Ms(timing.started - timing.queued),
+                    Ms(timing.worked - timing.started), Ms(timing.finished - launch));
+        }
+    }
+
+private:
+    struct Job {
+        Timing timing;
+        uint64_t sequence = 0;
+        std::function<void()> work;
+        std::function<void()> finish;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+    std::vector<Job> waiting;
+    std::vector<Job> worked;
+    std::vector<Timing> timings;
+    uint64_t nextSequence = 0;
+    int outstanding = 0;
+    bool stopping = false;
+
+    static double Ms(uint64_t nanoseconds) {
+        return nanoseconds / 1e6;
+    }
+
+    void Loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || !waiting.empty(); });
+            if (stopping) {
+                return;
+            }
+            // A handful of jobs, so a scan beats keeping a heap.
+            size_t next = 0;
+            for (size_t i = 1; i < waiting.size(); i++) {
+                const Job& a = waiting[i];
+                const Job& b = waiting[next];
+                if (a.timing.priority < b.timing.priority ||
+                    (a.timing.priority == b.timing.priority && a.sequence < b.sequence)) {
+                    next = i;
+                }
+            }
+            Job job = std::move(waiting[next]);
+            waiting.erase(waiting.begin() + next);
+            lock.unlock();
+            job.timing.started = ProfileNow();
+            job.work();
+            job.timing.worked = ProfileNow();
+            lock.lock();
+            worked.push_back(std::move(job));
+        }
+    }
+};
@@ -1,32 +1,135 @@
 #include <iostream>
 #include <raylib.h>
-#include <deque>
-#include <raymath.h>
 #include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
 
 #include "globals.h"
 #include "ui.h"
 #include "game.h"
 #include "screens.h"
 #include "audio.h"
+#include "profiler.h"
+#include "file_writer.h"
+#include "asset_pack.h"
+#include "load_queue.h"
+#include "latency.h"
+#include "frame_pacer.h"
 
 using namespace std;
 
-int main() {
+struct LaunchOptions {
+    const char* replayPath = nullptr;
+    const char* tracePath = nullptr;
+    unsigned long long seekTick = 0;
+    bool latency = false;
+    bool latencyTest = false;
+    int latencySamples = 25;
+    int fps = 120;
+    bool alignTicks = false;
+};
+
+// FPS caps the latency test runs each difficulty at.
+static const int LATENCY_TEST_FPS_CAPS[] = {30, 60, 120, 240};
+static const int LATENCY_TEST_RUNS = 3 * 4;
+
+// Options:
+//   --tick-rate HZ   run the simulation at HZ ticks per second instead of
+//                    the difficulty's preset speed
+//   --replay FILE    watch a recorded game (games are saved to last_game.snkr)
+//   --seek TICK      start the replay at TICK
+//   --trace FILE     write a Chrome trace_event profile of every frame to
+//                    FILE (F3 toggles the live profiler overlay)
+//   --latency        measure input-to-display latency while playing and
+//                    print it on exit
+//   --latency-test   play by itself with synthetic key presses at every
+//                    difficulty and several FPS caps, print the latency
+//                    report and exit
+//   --latency-samples N  turns measured per run of the test (default 25)
+//   --fps N          pace frames at N per second (default 120, 0 for
+//                    unpaced)
+//   --align-ticks    pull frames in to start as each simulation tick falls
+//                    due
+static void ParseArguments(int argc, char** argv, LaunchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            gameSettings.tickRate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            options.replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--seek") == 0 && i + 1 < argc) {
+            options.seekTick = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            options.tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--latency") == 0) {
+            options.latency = true;
+        } else if (strcmp(argv[i], "--latency-test") == 0) {
+            options.latency = true;
+            options.latencyTest = true;
+        } else if (strcmp(argv[i], "--latency-samples") == 0 && i + 1 < argc) {
+            options.latencySamples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            options.fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--align-ticks") == 0) {
+            options.alignTicks = true;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t launchTime = ProfileNow();
+    LaunchOptions options;
+    ParseArguments(argc, argv, options);
+
+    if (options.tracePath != nullptr && !profiler.StartTrace(options.tracePath)) {
+        fprintf(stderr, "Could not write trace to %s\n", options.tracePath);
+    }
+
     InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Snake - The Snake Game");
-    SetTargetFPS(120);
+    // Frames are paced by framePacer (frame_pacer.h), not raylib's wait.
+    int fpsCap = options.fps > 0 ? options.fps : 0;
+    SetTargetFPS(0);
+    framePacer.SetTarget(fpsCap);
+    framePacer.alignToTicks = options.alignTicks;
     SetExitKey(KEY_NULL);
 
+    // The menu is up before anything is loaded; assets arrive over the
+    // first few frames, and until then sounds are silent and the apple is a
+    // circle.
+    assetPack.Open(ASSET_PACK_PATH);
+    LoadQueue loader;
     AudioManager audio;
-    audio.Init();
+    audio.Load(loader);
 
     Game game = Game();
-    game.apple.LoadTexture();
-    game.highScore = LoadHighScore();
+    loader.Submit("apple texture", LOAD_HIGH, [&game]() { game.apple.PrepareTexture(); },
+                  [&game]() { game.apple.UploadTexture(); });
+    loader.Start();
+    // Indexed by ControlScheme; rebind keys here with Bind.
+    InputBindings bindings[] = {InputBindings::ForScheme(ARROW_KEYS), InputBindings::ForScheme(WASD)};
+    uint64_t firstFrameTime = 0;
+    bool startupReported = false;
+    leaderboard.Load("leaderboard.log");
     
     cellCount = gameSettings.GetCellCount();
     game.ApplySettings();
 
+    ReplayFile replayFile;
+    ReplayPlayer replayPlayer;
+    if (options.replayPath != nullptr) {
+        if (replayFile.Open(options.replayPath)) {
+            game.playback = &replayPlayer;
+            replayPlayer.Start(replayFile, game.sim);
+            if (options.seekTick > 0) {
+                replayPlayer.Seek(game.sim, options.seekTick);
+            }
+            cellCount = game.sim.config.cellCount;
+            currentState = PLAYING;
+        } else {
+            TraceLog(LOG_WARNING, "Could not open replay %s", options.replayPath);
+        }
+    }
+
     float menuBtnX = WINDOW_WIDTH/2 - 120;
     Button startButton(menuBtnX, 300, 240, 55, "START GAME", beige, darkGreen, 28);
     Button settingsButtonMenu(menuBtnX, 370, 240, 55, "SETTINGS", beige, darkGreen, 28);
@@ -55,10 +158,11 @@ int main() {
     SelectorButton difficultySelector(WINDOW_WIDTH/2 - 260, 190, 220, 40, "Difficulty",
                                       &difficultyIndex, 3, difficultyOptions);
     
-    const char* gridOptions[] = {"Small (15x15)", "Medium (20x20)", "Large (25x25)"};
+    const char* gridOptions[] = {"Small (15x15)", "Medium (20x20)", "Large (25x25)",
+                                 "Huge (256x256)", "Huge (1024x1024)", "Huge (4096x4096)"};
     int gridIndex = (int)gameSettings.gridSize;
     SelectorButton gridSelector(WINDOW_WIDTH/2 - 260, 265, 220, 40, "Grid Size",
-                               &gridIndex, 3, gridOptions);
+                               &gridIndex, 6, gridOptions);
     
     const char* controlOptions[] = {"Arrow Keys", "WASD"};
     int controlIndex = (int)gameSettings.controls;
@@ -73,14 +177,115 @@ int main() {
                                  &gameSettings.backgroundColorIndex, gameSettings.backgroundColors,
                                  gameSettings.backgroundColorNames, 5);
 
-    while (!WindowShouldClose()) {
-        audio.UpdateMusic();
+    FixedTimestep timestep;
+    GameState lastFrameState = currentState;
+
+    // Latency samples are filed under the difficulty and FPS cap they were
+    // taken at.
+    LatencyTracker latency;
+    SyntheticTurns synthetic;
+    int latencyRun = 0;
+    int latencyDifficulty = -1;
+    auto latencyLabel = [&]() {
+        return string(difficultyOptions[gameSettings.difficulty]) + " @ " + to_string(fpsCap) + " fps";
+    };
+    // Moves the latency test to its next difficulty and FPS cap; false once
+    // every run is done.
+    auto startLatencyRun = [&]() {
+        if (latencyRun == LATENCY_TEST_RUNS) {
+            return false;
+        }
+        gameSettings.difficulty = (Difficulty)(latencyRun / 4);
+        fpsCap = LATENCY_TEST_FPS_CAPS[latencyRun % 4];
+        framePacer.SetTarget(fpsCap);
+        latencyRun++;
+        game.inputs.Clear();
+        synthetic.Cancel();
+        latency.SetConfiguration(latencyLabel());
+        latencyDifficulty = gameSettings.difficulty;
+        return true;
+    };
+    if (options.latency) {
+        game.latency = &latency;
+        latency.SetConfiguration(latencyLabel());
+        latencyDifficulty = gameSettings.difficulty;
+    }
+    if (options.latencyTest) {
+        // A wrap-around board, so the random turns rarely end the game.
+        gameSettings.wallsEnabled = false;
+        gameSettings.gridSize = LARGE;
+        cellCount = gameSettings.GetCellCount();
+        game.playback = nullptr;
+        game.saveResults = false;
+        game.ApplySettings();
+        game.Reset();
+        currentState = PLAYING;
+        startLatencyRun();
+    }
+    bool quit = false;
+    bool eventWaiting = false;
+    bool wokenFrame = false;
+
+    // The frozen board behind the pause and game over overlays.
+    auto drawScene = [&]() {
+        ClearBackground(gameSettings.GetBackgroundColor());
+        DrawGameUI(game.sim.score, game.highScore, currentState == PAUSED, game.autopilot);
+        game.Draw();
+    };
+
+    while (!WindowShouldClose() && !quit) {
+        profiler.BeginFrame();
+        if (IsKeyPressed(KEY_F3)) {
+            profiler.overlayVisible = !profiler.overlayVisible;
+        }
+        if (!startupReported) {
+            loader.Pump();
+            if (firstFrameTime != 0 && loader.Done()) {
+                loader.Report(stdout, launchTime, firstFrameTime);
+                startupReported = true;
+            }
+        }
+        {
+            ProfileZone zone(ZONE_AUDIO);
+            audio.Sync(game.sim.score);
+        }
+        if (options.latency && !options.latencyTest && gameSettings.difficulty != latencyDifficulty) {
+            latencyDifficulty = gameSettings.difficulty;
+            latency.SetConfiguration(latencyLabel());
+        }
+        if (options.latencyTest) {
+            if (currentState == GAME_OVER) {
+                game.Reset();
+                currentState = PLAYING;
+            }
+            if (latency.Samples() >= options.latencySamples && !startLatencyRun()) {
+                quit = true;
+            }
+            // One turn in flight at a time, pressed at a random moment
+            // after the last one was shown.
+            uint64_t now = ProfileNow();
+            if (!synthetic.Armed() && game.inputs.Size() == 0 && latency.Pending() == 0) {
+                synthetic.Schedule(now, gameSettings.GetGameSpeed());
+            }
+            uint64_t pressTime;
+            if (synthetic.Due(now, pressTime)) {
+                game.Steer(synthetic.Pick(game.sim.direction), pressTime);
+            }
+        }
         
+        GameState frameState = currentState;
+        if (frameState != lastFrameState) {
+            // The board may have moved since this screen was last cached.
+            screenCache.Invalidate();
+        }
         BeginDrawing();
 
         switch (currentState) {
             case MENU: {
-                DrawMenu(startButton, settingsButtonMenu, exitButton, game.highScore);
+                {
+                    ProfileZone zone(ZONE_SCREEN);
+                    DrawMenu(startButton, settingsButtonMenu, exitButton, game.highScore);
+                }
                 
                 if (startButton.IsClicked() || IsKeyPressed(KEY_ENTER)) {
                     audio.PlayClickSound();
@@ -95,22 +300,59 @@ int main() {
                     currentState = SETTINGS;
                 }
                 if (exitButton.IsClicked() || IsKeyPressed(KEY_ESCAPE)) {
+                    screenCache.Unload();
                     CloseWindow();
+                    profiler.StopTrace();
+                    if (options.latency) {
+                        latency.Report(stdout);
+                    }
+                    framePacer.Report(stdout);
+                    loader.Stop();
                     audio.Cleanup();
+                    game.Submit();
+                    fileWriter.Stop();
                     return 0;
                 }
                 break;
             }
 
             case PLAYING: {
-                int previousScore = game.score;
+                if (lastFrameState != PLAYING) {
+                    timestep.Reset(GetTime());
+                    profiler.ResetTicks();
+                }
+
+                if (IsKeyPressed(KEY_F2) && game.playback == nullptr) {
+                    game.autopilot = !game.autopilot;
+                    game.inputs.Clear();
+                }
+
+                bool canMove = !game.pause && !game.autopilot;
+                
+                if (canMove) {
+                    // Every press this frame, in the order they were made.
+                    const InputBindings& keys = bindings[gameSettings.controls];
+                    uint64_t now = ProfileNow();
+                    for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed()) {
+                        game.Steer(keys.Lookup(key), now);
+                    }
+                }
+
+                int previousScore = game.sim.score;
                 bool wasRunning = game.running;
                 
-                if (eventTriggered(gameSettings.GetGameSpeed())) {
+                double interval = gameSettings.GetGameSpeed();
+                int ticks = timestep.Advance(GetTime(), interval);
+                for (int i = 0; i < ticks && game.running; i++) {
+                    ProfileZone zone(ZONE_UPDATE);
+                    profiler.MarkTick(interval);
+                    if (game.autopilot) {
+                        game.Steer(game.pilot.Choose(game.sim));
+                    }
                     game.Update();
                 }
                 
-                if (game.score > previousScore) {
+                if (game.sim.score > previousScore) {
                     audio.PlayEatSound();
                 }
                 
@@ -118,44 +360,6 @@ int main() {
                     audio.PlayGameOverSound();
                 }
 
-                bool canMove = !game.pause;
-                
-                if (gameSettings.controls == ARROW_KEYS) {
-                    if (IsKeyPressed(KEY_UP) && game.snake.direction.y != 1 && canMove) {
-                        game.snake.direction = {0, -1};
-                        game.running = true;
-                    }
-                    if (IsKeyPressed(KEY_DOWN) && game.snake.direction.y != -1 && canMove) {
-                        game.snake.direction = {0, 1};
-                        game.running = true;
-                    }
-                    if (IsKeyPressed(KEY_LEFT) && game.snake.direction.x != 1 && canMove) {
-                        game.snake.direction = {-1, 0};
-                        game.running = true;
-                    }
-                    if (IsKeyPressed(KEY_RIGHT) && game.snake.direction.x != -1 && canMove) {
-                        game.snake.direction = {1, 0};
-                        game.running = true;
-                    }
-                } else {
-                    if (IsKeyPressed(KEY_W) && game.snake.direction.y != 1 && canMove) {
-                        game.snake.direction = {0, -1};
-                        game.running = true;
-                    }
-                    if (IsKeyPressed(KEY_S) && game.snake.direction.y != -1 && canMove) {
-                        game.snake.direction = {0, 1};
-                        game.running = true;
-                    }
-                    if (IsKeyPressed(KEY_A) && game.snake.direction.x != 1 && canMove) {
-                        game.snake.direction = {-1, 0};
-                        game.running = true;
-                    }
-                    if (IsKeyPressed(KEY_D) && game.snake.direction.x != -1 && canMove) {
-                        game.snake.direction = {1, 0};
-                        game.running = true;
-                    }
-                }
-
                 if (IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_P)) {
                     game.pause = !game.pause;
                     if (game.pause) {
@@ -167,23 +371,41 @@ int main() {
                     game.Reset();
                 }
 
+                // Only huge boards scroll; smaller ones ignore the zoom.
+                float wheel = GetMouseWheelMove();
+                if (wheel != 0) {
+                    game.camera.Zoom(powf(1.25f, wheel));
+                }
+                if (IsKeyPressed(KEY_EQUAL) || IsKeyPressed(KEY_KP_ADD)) {
+                    game.camera.Zoom(2.0f);
+                }
+                if (IsKeyPressed(KEY_MINUS) || IsKeyPressed(KEY_KP_SUBTRACT)) {
+                    game.camera.Zoom(0.5f);
+                }
+
                 if (IsKeyPressed(KEY_ESCAPE)) {
                     game.pause = true;
                     currentState = PAUSED;
                 }
 
                 ClearBackground(gameSettings.GetBackgroundColor());
-                DrawGameUI(game.score, game.highScore, game.pause);
-                game.Draw();
+                {
+                    ProfileZone zone(ZONE_DRAW_UI);
+                    DrawGameUI(game.sim.score, game.highScore, game.pause, game.autopilot);
+                }
+                {
+                    ProfileZone zone(ZONE_DRAW_GAME);
+                    game.Draw(game.running ? timestep.Alpha(interval) : 1.0f);
+                }
                 break;
             }
 
             case PAUSED: {
-                ClearBackground(gameSettings.GetBackgroundColor());
-                DrawGameUI(game.score, game.highScore, true);
-                game.Draw();
-                
-                DrawPauseOverlay(resumeButton, restartPauseButton, settingsPauseButton, menuPauseButton);
+                {
+                    ProfileZone zone(ZONE_SCREEN);
+                    DrawPauseOverlay(resumeButton, restartPauseButton, settingsPauseButton, menuPauseButton,
+                                     drawScene, game.sim.score);
+                }
                 
                 if (resumeButton.IsClicked() || IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_P)) {
                     audio.PlayClickSound();
@@ -203,14 +425,18 @@ int main() {
                 if (menuPauseButton.IsClicked() || IsKeyPressed(KEY_ESCAPE)) {
                     audio.PlayClickSound();
                     currentState = MENU;
+                    game.playback = nullptr;
                     game.Reset();
                 }
                 break;
             }
 
             case SETTINGS: {
-                DrawSettingsMenu(backButton, deleteHighScoreButton, soundVolumeSelector, wallsToggle, difficultySelector,
-                               gridSelector, controlsSelector, snakeColorSelector, bgColorSelector);
+                {
+                    ProfileZone zone(ZONE_SCREEN);
+                    DrawSettingsMenu(backButton, deleteHighScoreButton, soundVolumeSelector, wallsToggle, difficultySelector,
+                                   gridSelector, controlsSelector, snakeColorSelector, bgColorSelector);
+                }
                 
                 gameSettings.difficulty = (Difficulty)difficultyIndex;
                 gameSettings.gridSize = (GridSize)gridIndex;
@@ -219,7 +445,9 @@ int main() {
                 
                 if (deleteHighScoreButton.IsClicked()) {
                     audio.PlayClickSound();
-                    DeleteHighScore();
+                    leaderboard.Clear();
+                    game.highScore = 0;
+                    game.submitted = true;
                 }
                 
                 if (backButton.IsClicked() || IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_BACKSPACE)) {
@@ -227,6 +455,9 @@ int main() {
                     if (cellCount != gameSettings.GetCellCount()) {
                         cellCount = gameSettings.GetCellCount();
                         game.ApplySettings();
+                    } else if (previousState == MENU) {
+                        // Show the best score for the board the next game will use.
+                        game.highScore = leaderboard.Best(gameSettings.GetBoardKey());
                     }
                     currentState = previousState;
                     if (previousState == PAUSED) {
@@ -237,11 +468,10 @@ int main() {
             }
 
             case GAME_OVER: {
-                ClearBackground(gameSettings.GetBackgroundColor());
-                DrawGameUI(game.score, game.highScore, false);
-                game.Draw();
-                
-                DrawGameOver(restartButton, menuButtonGO, game.score, game.highScore);
+                {
+                    ProfileZone zone(ZONE_SCREEN);
+                    DrawGameOver(restartButton, menuButtonGO, drawScene, game.sim.score, game.highScore, game.sim.won);
+                }
                 
                 if (restartButton.IsClicked() || IsKeyPressed(KEY_R) || IsKeyPressed(KEY_ENTER)) {
                     audio.PlayClickSound();
@@ -251,16 +481,65 @@ int main() {
                 if (menuButtonGO.IsClicked() || IsKeyPressed(KEY_ESCAPE)) {
                     audio.PlayClickSound();
                     currentState = MENU;
+                    game.playback = nullptr;
                     game.Reset();
                 }
                 break;
             }
         }
 
-        EndDrawing();
+        if (profiler.overlayVisible) {
+            DrawProfilerOverlay();
+        }
+        // Outside play nothing on screen changes until the player does
+        // something, so EndDrawing is left to sleep until the next input
+        // event (key, mouse move or click, window event) instead of drawing
+        // at the frame rate. A wake draws two frames: the first handles the
+        // event, which may change things it already drew, and the second
+        // shows the result before sleeping again. Startup loading, the
+        // profiler overlay and the latency test need every frame.
+        bool idle = frameState == currentState && currentState != PLAYING && !wokenFrame && startupReported &&
+                    !profiler.overlayVisible && !options.latencyTest;
+        if (idle != eventWaiting) {
+            if (idle) EnableEventWaiting();
+            else DisableEventWaiting();
+            eventWaiting = idle;
+        }
+        wokenFrame = idle;
+        {
+            // Includes waiting for the next frame slot, or for input when
+            // idle. The slot is waited for before presenting, so the frame
+            // reaches the screen on time.
+            ProfileZone zone(ZONE_PRESENT);
+            if (!eventWaiting) {
+                uint64_t tickDue = 0;
+                if (currentState == PLAYING && game.running && !game.pause) {
+                    double remaining = timestep.Remaining(GetTime(), gameSettings.GetGameSpeed());
+                    tickDue = ProfileNow() + (uint64_t)(remaining * 1e9);
+                }
+                framePacer.Wait(tickDue);
+            }
+            EndDrawing();
+        }
+        if (firstFrameTime == 0) {
+            firstFrameTime = ProfileNow();
+        }
+        if (game.latency != nullptr) {
+            game.latency->Presented(ProfileNow());
+        }
+        lastFrameState = frameState;
     }
 
+    if (options.latency) {
+        latency.Report(stdout);
+    }
+    framePacer.Report(stdout);
+    loader.Stop();
     audio.Cleanup();
+    screenCache.Unload();
     CloseWindow();
+    profiler.StopTrace();
+    game.Submit();
+    fileWriter.Stop();
     return 0;
 }
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file. Pages are brought in by the OS
+// as they are touched, so large files can be streamed without reading them
+// up front. Platform headers stay in mapped_file.cpp, away from raylib.
+class MappedFile {
+public:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+        Close();
+    }
+
+    bool Open(const char* path);
+    void Close();
+
+    bool IsOpen() const {
+        return data != nullptr;
+    }
+
+private:
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "raylib.h"
+#include "asset_pack.h"
+
+// Builds assets.pack (see asset_pack.h) from the loose files the game ships
+// with. Run it from the project directory after changing any of them:
+//
+//   snake_packer [--out FILE] [--cell-size PIXELS]
+//
+// The decoding and resizing the game used to do at every launch happens
+// here instead, using raylib's own loaders, so the pack holds exactly the
+// bytes the game uploads. --cell-size must match cellSize in globals.cpp; the
+// game resizes a mismatched apple itself rather than failing.
+
+using namespace std;
+
+struct PackSource {
+    const char* path;
+    AssetKind kind;
+};
+
+// Sounds are synthesised at run time (synth.h), so only art is packed.
+static const PackSource SOURCES[] = {
+    {"Graphics/apple.png", ASSET_IMAGE},
+};
+
+struct PackedAsset {
+    const char* name;
+    AssetKind kind;
+    uint32_t params[4];
+    vector<uint8_t> bytes;
+};
+
+static void Put(vector<uint8_t>& data, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) data.push_back((uint8_t)(value >> (8 * i)));
+}
+
+static bool PackImage(const char* path, int cellPixels, PackedAsset& asset) {
+    Image image = LoadImage(path);
+    if (image.data == nullptr) {
+        return false;
+    }
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    ImageResize(&image, cellPixels, cellPixels);
+    size_t size = (size_t)image.width * image.height * 4;
+    const uint8_t* pixels = (const uint8_t*)image.data;
+    asset.bytes.assign(pixels, pixels + size);
+    asset.params[0] = (uint32_t)image.width;
+    asset.params[1] = (uint32_t)image.height;
+    asset.params[2] = (uint32_t)image.format;
+    asset.params[3] = 1;
+    UnloadImage(image);
+    return true;
+}
+
+static uint64_t AlignUp(uint64_t value) {
+    return (value + ASSET_ALIGNMENT - 1) / ASSET_ALIGNMENT * ASSET_ALIGNMENT;
+}
+
+int main(int argc, char** argv) {
+    const char* outPath = ASSET_PACK_PATH;
+    int cellPixels = 30;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "--cell-size") == 0 && i + 1 < argc) {
+            cellPixels = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (cellPixels <= 0) {
+        fprintf(stderr, "--cell-size must be positive\n");
+        return 1;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+
+    vector<PackedAsset> assets;
+    for (const PackSource& source : SOURCES) {
+        if (strlen(source.path) > (size_t)ASSET_NAME_SIZE) {
+            fprintf(stderr, "Asset name too long: %s\n", source.path);
+            return 1;
+        }
+        PackedAsset asset = {source.path, source.kind, {0, 0, 0, 0}, {}};
+        bool loaded = source.kind == ASSET_IMAGE && PackImage(source.path, cellPixels, asset);
+        if (!loaded) {
+            fprintf(stderr, "Could not load %s\n", source.path);
+            return 1;
+        }
+        assets.push_back(asset);
+    }
+
+    vector<uint8_t> pack;
+    Put(pack, ASSET_PACK_MAGIC, 4);
+    Put(pack, ASSET_PACK_VERSION, 4);
+    Put(pack, assets.size(), 4);
+    Put(pack, ASSET_ALIGNMENT, 4);
+    uint64_t offset = AlignUp(ASSET_PACK_HEADER_SIZE + (uint64_t)assets.size() * ASSET_ENTRY_SIZE);
+    for (const PackedAsset& asset : assets) {
+        char name[ASSET_NAME_SIZE] = {};
+        memcpy(name, asset.name, strlen(asset.name));
+        pack.insert(pack.end(), name, name + ASSET_NAME_SIZE);
+        Put(pack, asset.kind, 4);
+        for (uint32_t param : asset.params) Put(pack, param, 4);
+        Put(pack, 0, 4);
+        Put(pack, offset, 8);
+        Put(pack, asset.bytes.size(), 8);
+        offset = AlignUp(offset + asset.bytes.size());
+    }
+    for (const PackedAsset& asset : assets) {
+        pack.resize(AlignUp(pack.size()), 0);
+        pack.insert(pack.end(), asset.bytes.begin(), asset.bytes.end());
+    }
+
+    FILE* file = fopen(outPath, "wb");
+    if (file == nullptr || fwrite(pack.data(), 1, pack.size(), file) != pack.size()) {
+        fprintf(stderr, "Could not write %s\n", outPath);
+        if (file != nullptr) fclose(file);
+        return 1;
+    }
+    fclose(file);
+    for (const PackedAsset& asset : assets) {
+        printf("%-22s %8zu bytes\n", asset.name, asset.bytes.size());
+    }
+    printf("Wrote %s (%zu bytes)\n", outPath, pack.size());
+    return 0;
+}
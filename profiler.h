@@ -0,0 +1,229 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+
+// Frame profiler. Code marks phases with ProfileZone (a scoped timer); the
+// main thread keeps per-frame totals for the overlay, and when tracing every
+// zone is also pushed into a lock-free single-producer ring that a writer
+// thread drains into a Chrome trace_event file (open it in chrome://tracing
+// or Perfetto). Nothing here depends on raylib; the overlay lives in
+// screens.h.
+
+enum ProfileZoneId {
+    ZONE_FRAME,
+    ZONE_AUDIO,
+    ZONE_UPDATE,
+    ZONE_DRAW_UI,
+    ZONE_DRAW_GAME,
+    ZONE_SCREEN,
+    ZONE_PRESENT,
+    ZONE_COUNT
+};
+
+static const char* const PROFILE_ZONE_NAMES[ZONE_COUNT] = {
+    "frame", "audio", "update", "draw ui", "draw game", "screen", "present"
+};
+
+inline uint64_t ProfileNow() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct ProfileEvent {
+    uint64_t start;
+    uint64_t end;
+    uint32_t zone;
+};
+
+class Profiler {
+public:
+    static const int HISTORY = 512;
+
+    // Summary of the last HISTORY frames, refreshed a few times a second.
+    struct Stats {
+        double frameP50 = 0;
+        double frameP99 = 0;
+        double frameMax = 0;
+        double jitterP50 = 0;
+        double jitterP99 = 0;
+        double zoneMean[ZONE_COUNT] = {};
+        int draws = 0;
+        long long dropped = 0;
+    };
+
+    bool overlayVisible = false;
+    Stats stats;
+
+    ~Profiler() {
+        StopTrace();
+    }
+
+    bool StartTrace(const char* path) {
+        traceFile = fopen(path, "w");
+        if (traceFile == nullptr) {
+            return false;
+        }
+        fprintf(traceFile, "{\"traceEvents\":[\n");
+        fprintf(traceFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}");
+        traceOrigin = ProfileNow();
+        tracing.store(true, std::memory_order_release);
+        traceThread = std::thread([this]() { TraceLoop(); });
+        return true;
+    }
+
+    // Drains what is left and closes the JSON. Safe to call twice.
+    void StopTrace() {
+        if (!traceThread.joinable()) {
+            return;
+        }
+        tracing.store(false, std::memory_order_release);
+        traceThread.join();
+        fprintf(traceFile, "\n]}\n");
+        fclose(traceFile);
+        traceFile = nullptr;
+    }
+
+    void BeginFrame() {
+        uint64_t now = ProfileNow();
+        if (frameStart != 0) {
+            Record(ZONE_FRAME, frameStart, now);
+            frameTimes[frameCursor] = (now - frameStart) * 1e-6;
+            for (int zone = 0; zone < ZONE_COUNT; zone++) {
+                zoneTimes[zone][frameCursor] = zoneAccum[zone] * 1e-6;
+                zoneAccum[zone] = 0;
+            }
+            drawHistory[frameCursor] = drawCount;
+            frameCursor = (frameCursor + 1) % HISTORY;
+            if (frameFilled < HISTORY) frameFilled++;
+            if (now - lastSummary > 250000000ull) {
+                Summarise();
+                lastSummary = now;
+            }
+        }
+        drawCount = 0;
+        frameStart = now;
+    }
+
+    // Call once per simulation tick with the interval it should run at.
+    // Jitter is how far the spacing of ticks strays from that interval.
+    void MarkTick(double interval) {
+        uint64_t now = ProfileNow();
+        if (lastTick != 0) {
+            double late = (now - lastTick) * 1e-9 - interval;
+            tickJitter[tickCursor] = (late < 0 ? -late : late) * 1e3;
+            tickCursor = (tickCursor + 1) % HISTORY;
+            if (tickFilled < HISTORY) tickFilled++;
+        }
+        lastTick = now;
+    }
+
+    // Forgets the last tick, e.g. while paused, so the gap does not count
+    // as jitter.
+    void ResetTicks() {
+        lastTick = 0;
+    }
+
+    void CountDraws(int count) {
+        drawCount += count;
+    }
+
+    void Record(int zone, uint64_t start, uint64_t end) {
+        zoneAccum[zone] += end - start;
+        if (tracing.load(std::memory_order_relaxed) && !ring.Push(ProfileEvent{start, end, (uint32_t)zone})) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    SpscRing<ProfileEvent, 16384> ring;
+    std::atomic<bool> tracing{false};
+    std::atomic<long long> dropped{0};
+    std::thread traceThread;
+    FILE* traceFile = nullptr;
+    uint64_t traceOrigin = 0;
+
+    uint64_t frameStart = 0;
+    uint64_t lastSummary = 0;
+    uint64_t lastTick = 0;
+    uint64_t zoneAccum[ZONE_COUNT] = {};
+    int drawCount = 0;
+
+    double frameTimes[HISTORY] = {};
+    double zoneTimes[ZONE_COUNT][HISTORY] = {};
+    int drawHistory[HISTORY] = {};
+    int frameCursor = 0;
+    int frameFilled = 0;
+    double tickJitter[HISTORY] = {};
+    int tickCursor = 0;
+    int tickFilled = 0;
+
+    static double Percentile(std::vector<double>& values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        size_t k = (size_t)(p * (values.size() - 1));
+        std::nth_element(values.begin(), values.begin() + k, values.end());
+        return values[k];
+    }
+
+    void Summarise() {
+        std::vector<double> frames(frameTimes, frameTimes + frameFilled);
+        stats.frameP50 = Percentile(frames, 0.5);
+        stats.frameP99 = Percentile(frames, 0.99);
+        stats.frameMax = frames.empty() ? 0 : *std::max_element(frames.begin(), frames.end());
+        std::vector<double> jitter(tickJitter, tickJitter + tickFilled);
+        stats.jitterP50 = Percentile(jitter, 0.5);
+        stats.jitterP99 = Percentile(jitter, 0.99);
+        for (int zone = 0; zone < ZONE_COUNT; zone++) {
+            double total = 0;
+            for (int i = 0; i < frameFilled; i++) total += zoneTimes[zone][i];
+            stats.zoneMean[zone] = frameFilled > 0 ? total / frameFilled : 0;
+        }
+        int last = (frameCursor + HISTORY - 1) % HISTORY;
+        stats.draws = frameFilled > 0 ? drawHistory[last] : 0;
+        stats.dropped = dropped.load(std::memory_order_relaxed);
+    }
+
+    void TraceLoop() {
+        ProfileEvent event;
+        for (;;) {
+            bool running = tracing.load(std::memory_order_acquire);
+            bool any = false;
+            while (ring.Pop(event)) {
+                any = true;
+                fprintf(traceFile, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                        PROFILE_ZONE_NAMES[event.zone],
+                        (event.start - traceOrigin) * 1e-3, (event.end - event.start) * 1e-3);
+            }
+            if (!running) {
+                break;
+            }
+            if (any) {
+                // Keep the file useful if the process is killed.
+                fflush(traceFile);
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+    }
+};
+
+inline Profiler profiler;
+
+// Times the enclosing scope as one zone.
+class ProfileZone {
+public:
+    explicit ProfileZone(ProfileZoneId id) : zone(id), start(ProfileNow()) {}
+    ~ProfileZone() { profiler.Record(zone, start, ProfileNow()); }
+
+private:
+    ProfileZoneId zone;
+    uint64_t start;
+};
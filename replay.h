@@ -0,0 +1,429 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "simulation.h"
+#include "mapped_file.h"
+
+// Replay files record one game as its seed plus the inputs that changed
+// direction, so a whole game costs a couple of bytes per turn. Full state
+// keyframes every keyframeInterval ticks let playback seek to any tick by
+// restoring one keyframe and simulating fewer than keyframeInterval ticks.
+//
+// Layout (little-endian):
+//   header    "SNKR", u16 version, u8 cellBytes, u8 walls, u32 cellCount,
+//             u32 keyframeInterval, u64 seed
+//   records   one tag byte each, then:
+//               TAG_INPUT | dir  varint ticks since the previous record
+//               TAG_KEYFRAME     varint payload size, snapshot
+//               TAG_END          varint final tick
+//   index     u64 offset of each keyframe record, in tick order
+//   trailer   u64 index offset, u32 keyframe count, "SNKI"
+//
+// Records appear in tick order; a keyframe at tick t describes the state
+// before the step that uses tick t's input. A keyframeInterval of 0 means the
+// file has no keyframes and seeking replays from the seed; recordings on
+// boards bigger than 256x256 use it, since one snapshot of a 4096x4096 board
+// is tens of megabytes.
+
+static const uint32_t REPLAY_MAGIC = 0x524B4E53;        // "SNKR"
+static const uint32_t REPLAY_INDEX_MAGIC = 0x494B4E53;  // "SNKI"
+static const uint16_t REPLAY_VERSION = 1;
+static const int REPLAY_HEADER_SIZE = 24;
+static const int REPLAY_TRAILER_SIZE = 16;
+static const int REPLAY_MAX_KEYFRAME_CELLS = 65536;
+
+enum ReplayTag {
+    TAG_INPUT = 0x10,
+    TAG_KEYFRAME = 0x20,
+    TAG_END = 0x30
+};
+
+struct ReplayHeader {
+    uint16_t version = REPLAY_VERSION;
+    int cellBytes = 2;
+    bool wallsEnabled = true;
+    int cellCount = 20;
+    uint32_t keyframeInterval = 256;
+    uint64_t seed = 0;
+};
+
+class ReplayWriter {
+public:
+    ReplayHeader header;
+    std::vector<uint8_t> data;
+    std::vector<uint64_t> keyframeOffsets;
+    uint64_t lastTick = 0;
+    bool recording = false;
+    bool finished = false;
+
+    void Begin(const SimConfig& config) {
+        Begin(config, config.cellCount * config.cellCount <= REPLAY_MAX_KEYFRAME_CELLS ? 256 : 0);
+    }
+
+    void Begin(const SimConfig& config, uint32_t keyframeInterval) {
+        header = ReplayHeader();
+        header.cellCount = config.cellCount;
+        header.cellBytes = config.cellCount * config.cellCount <= 65536 ? 2 : 4;
+        header.wallsEnabled = config.wallsEnabled;
+        header.keyframeInterval = keyframeInterval;
+        header.seed = config.seed;
+
+        data.clear();
+        keyframeOffsets.clear();
+        lastTick = 0;
+        recording = true;
+        finished = false;
+
+        PutU32(REPLAY_MAGIC);
+        PutU16(header.version);
+        data.push_back((uint8_t)header.cellBytes);
+        data.push_back(header.wallsEnabled ? 1 : 0);
+        PutU32((uint32_t)header.cellCount);
+        PutU32(header.keyframeInterval);
+        PutU64(header.seed);
+    }
+
+    // Call before each step with the input that step will receive.
+    void Record(const Simulation& sim, Direction input) {
+        if (!recording) {
+            return;
+        }
+        if (header.keyframeInterval != 0 && sim.tick % header.keyframeInterval == 0) {
+            WriteKeyframe(sim);
+        }
+        if (input != DIR_NONE) {
+            data.push_back((uint8_t)(TAG_INPUT | input));
+            PutVarint(sim.tick - lastTick);
+            lastTick = sim.tick;
+        }
+    }
+
+    void Finish(const Simulation& sim) {
+        if (!recording) {
+            return;
+        }
+        data.push_back(TAG_END);
+        PutVarint(sim.tick);
+
+        uint64_t indexOffset = data.size();
+        for (uint64_t offset : keyframeOffsets) {
+            PutU64(offset);
+        }
+        PutU64(indexOffset);
+        PutU32((uint32_t)keyframeOffsets.size());
+        PutU32(REPLAY_INDEX_MAGIC);
+        recording = false;
+        finished = true;
+    }
+
+    bool Save(const char* path) const {
+        FILE* file = fopen(path, "wb");
+        if (file == NULL) {
+            return false;
+        }
+        bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+        return fclose(file) == 0 && ok;
+    }
+
+private:
+    void WriteKeyframe(const Simulation& sim) {
+        keyframeOffsets.push_back(data.size());
+        data.push_back(TAG_KEYFRAME);
+
+        std::vector<uint8_t> payload;
+        payload.swap(data);
+        PutVarint(sim.tick);
+        data.push_back((uint8_t)sim.direction);
+        data.push_back((uint8_t)((sim.growPending ? 1 : 0) | (sim.moved ? 2 : 0) |
+                                 (sim.alive ? 4 : 0) | (sim.won ? 8 : 0)));
+        PutVarint((uint64_t)sim.score);
+        PutU64(sim.rng.state);
+        PutU32((uint32_t)sim.CellIndex(sim.apple));
+        PutU32((uint32_t)sim.vacatedTail);
+        PutVarint((uint64_t)sim.body.Size());
+        for (int i = 0; i < sim.body.Size(); i++) {
+            PutCell(sim.body.IndexAt(i));
+        }
+        PutVarint((uint64_t)sim.freeCells.Size());
+        for (int cell : sim.freeCells.cells) {
+            PutCell(cell);
+        }
+        payload.swap(data);
+
+        PutVarint(payload.size());
+        data.insert(data.end(), payload.begin(), payload.end());
+        lastTick = sim.tick;
+    }
+
+    void PutCell(int cell) {
+        if (header.cellBytes == 2) PutU16((uint16_t)cell);
+        else PutU32((uint32_t)cell);
+    }
+
+    void PutU16(uint16_t value) {
+        data.push_back((uint8_t)value);
+        data.push_back((uint8_t)(value >> 8));
+    }
+
+    void PutU32(uint32_t value) {
+        for (int i = 0; i < 4; i++) data.push_back((uint8_t)(value >> (8 * i)));
+    }
+
+    void PutU64(uint64_t value) {
+        for (int i = 0; i < 8; i++) data.push_back((uint8_t)(value >> (8 * i)));
+    }
+
+    void PutVarint(uint64_t value) {
+        while (value >= 0x80) {
+            data.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        data.push_back((uint8_t)value);
+    }
+};
+
+// Bounds-checked little-endian reads over a byte range.
+struct ReplayCursor {
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+    bool ok;
+
+    uint8_t U8() {
+        if (position + 1 > size) { ok = false; return 0; }
+        return data[position++];
+    }
+
+    uint64_t Fixed(int bytes) {
+        if (position + bytes > size) { ok = false; return 0; }
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= (uint64_t)data[position + i] << (8 * i);
+        position += bytes;
+        return value;
+    }
+
+    uint64_t Varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = U8();
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+// A replay file opened for playback. The file is memory-mapped and only the
+// header and keyframe index are read up front.
+class ReplayFile {
+public:
+    MappedFile file;
+    ReplayHeader header;
+    const uint8_t* index = nullptr;
+    uint32_t keyframeCount = 0;
+    size_t recordsEnd = 0;
+
+    bool Open(const char* path) {
+        if (!file.Open(path) || file.size < (size_t)(REPLAY_HEADER_SIZE + REPLAY_TRAILER_SIZE)) {
+            return false;
+        }
+        ReplayCursor cursor = {file.data, file.size, 0, true};
+        if (cursor.Fixed(4) != REPLAY_MAGIC) {
+            return false;
+        }
+        header.version = (uint16_t)cursor.Fixed(2);
+        header.cellBytes = cursor.U8();
+        header.wallsEnabled = cursor.U8() != 0;
+        header.cellCount = (int)cursor.Fixed(4);
+        header.keyframeInterval = (uint32_t)cursor.Fixed(4);
+        header.seed = cursor.Fixed(8);
+        // The same grid range the game and headless --grid allow; anything
+        // else is a damaged or hostile file, not a game to set up.
+        if (header.version != REPLAY_VERSION || (header.cellBytes != 2 && header.cellBytes != 4) ||
+            header.cellCount < 4 || (int64_t)header.cellCount * header.cellCount > SnakeBody::MAX_CELLS ||
+            (header.cellBytes == 2 && header.cellCount * header.cellCount > 65536)) {
+            return false;
+        }
+
+        cursor.position = file.size - REPLAY_TRAILER_SIZE;
+        uint64_t indexOffset = cursor.Fixed(8);
+        keyframeCount = (uint32_t)cursor.Fixed(4);
+        // The index sits between the records and the trailer, exactly
+        // keyframeCount entries long. Checked without adding the two, which
+        // a crafted trailer could make wrap around.
+        uint64_t indexEnd = file.size - REPLAY_TRAILER_SIZE;
+        if (cursor.Fixed(4) != REPLAY_INDEX_MAGIC || indexOffset < (uint64_t)REPLAY_HEADER_SIZE ||
+            indexOffset > indexEnd || (indexEnd - indexOffset) % 8 != 0 ||
+            keyframeCount != (indexEnd - indexOffset) / 8) {
+            return false;
+        }
+        if (header.keyframeInterval == 0 && keyframeCount != 0) {
+            return false;
+        }
+        index = file.data + indexOffset;
+        recordsEnd = (size_t)indexOffset;
+        return true;
+    }
+
+    SimConfig Config() const {
+        SimConfig config;
+        config.cellCount = header.cellCount;
+        config.wallsEnabled = header.wallsEnabled;
+        config.seed = header.seed;
+        return config;
+    }
+
+    uint64_t KeyframeOffset(uint32_t k) const {
+        ReplayCursor cursor = {index, (size_t)keyframeCount * 8, (size_t)k * 8, true};
+        return cursor.Fixed(8);
+    }
+};
+
+// Feeds a recorded game into a Simulation, from the start or from any tick.
+class ReplayPlayer {
+public:
+    const ReplayFile* replay = nullptr;
+    ReplayCursor cursor = {nullptr, 0, 0, false};
+    uint64_t recordTick = 0;
+    uint64_t endTick = 0;
+    bool ended = false;
+
+    void Start(const ReplayFile& file, Simulation& sim) {
+        replay = &file;
+        sim.Configure(file.Config());
+        cursor = ReplayCursor{file.file.data, file.recordsEnd, REPLAY_HEADER_SIZE, true};
+        recordTick = 0;
+        ended = false;
+    }
+
+    // Restores the keyframe at or before tick and simulates forward to it.
+    // Keyframes sit at fixed intervals, so finding one is a direct lookup.
+    // Files without keyframes are replayed from the start.
+    bool Seek(Simulation& sim, uint64_t tick) {
+        if (replay == nullptr) {
+            return false;
+        }
+        if (replay->keyframeCount == 0) {
+            Start(*replay, sim);
+            while (sim.tick < tick && sim.alive && !ended) {
+                Step(sim);
+            }
+            return cursor.ok;
+        }
+        uint64_t k = tick / replay->header.keyframeInterval;
+        if (k >= replay->keyframeCount) {
+            k = replay->keyframeCount - 1;
+        }
+        cursor = ReplayCursor{replay->file.data, replay->recordsEnd, (size_t)replay->KeyframeOffset((uint32_t)k), true};
+        if (cursor.U8() != TAG_KEYFRAME || !ReadKeyframe(sim)) {
+            return false;
+        }
+        ended = false;
+        while (sim.tick < tick && sim.alive && !ended) {
+            Step(sim);
+        }
+        return cursor.ok;
+    }
+
+    StepResult Step(Simulation& sim) {
+        return sim.Step(InputFor(sim.tick));
+    }
+
+    // Returns the recorded input for the step taken at tick, consuming
+    // records up to it.
+    Direction InputFor(uint64_t tick) {
+        while (cursor.ok && !ended && cursor.position < cursor.size) {
+            size_t start = cursor.position;
+            uint8_t tag = cursor.U8();
+            if ((tag & 0xF0) == TAG_INPUT) {
+                uint64_t at = recordTick + cursor.Varint();
+                if (at > tick) {
+                    cursor.position = start;
+                    return DIR_NONE;
+                }
+                recordTick = at;
+                if (at == tick) {
+                    return (Direction)(tag & 0x0F);
+                }
+            } else if (tag == TAG_KEYFRAME) {
+                size_t payloadSize = (size_t)cursor.Varint();
+                ReplayCursor peek = {cursor.data, cursor.size, cursor.position, true};
+                uint64_t at = peek.Varint();
+                if (at > tick) {
+                    cursor.position = start;
+                    return DIR_NONE;
+                }
+                recordTick = at;
+                cursor.position += payloadSize;
+            } else if (tag == TAG_END) {
+                endTick = cursor.Varint();
+                ended = true;
+            } else {
+                cursor.ok = false;
+            }
+        }
+        return DIR_NONE;
+    }
+
+private:
+    bool ReadKeyframe(Simulation& sim) {
+        cursor.Varint();
+        int cellBytes = replay->header.cellBytes;
+        sim.config = replay->Config();
+
+        uint64_t tick = cursor.Varint();
+        int direction = cursor.U8();
+        uint8_t flags = cursor.U8();
+        int score = (int)cursor.Varint();
+        uint64_t rngState = cursor.Fixed(8);
+        int apple = (int)cursor.Fixed(4);
+        int vacatedTail = (int)(int32_t)cursor.Fixed(4);
+
+        int cellTotal = sim.config.cellCount * sim.config.cellCount;
+        uint64_t bodyCount = cursor.Varint();
+        if (!cursor.ok || bodyCount == 0 || bodyCount > (uint64_t)cellTotal) {
+            cursor.ok = false;
+            return false;
+        }
+        std::vector<int> bodyCells((size_t)bodyCount);
+        for (int& cell : bodyCells) cell = (int)cursor.Fixed(cellBytes);
+        uint64_t freeCount = cursor.Varint();
+        if (!cursor.ok || freeCount != (uint64_t)cellTotal - bodyCount) {
+            cursor.ok = false;
+            return false;
+        }
+        std::vector<int> freeOrder((size_t)freeCount);
+        for (int& cell : freeOrder) cell = (int)cursor.Fixed(cellBytes);
+        if (!cursor.ok || apple < 0 || apple >= cellTotal || direction < DIR_UP || direction > DIR_RIGHT ||
+            vacatedTail < -1 || vacatedTail >= cellTotal) {
+            cursor.ok = false;
+            return false;
+        }
+        // Body and free cells together must name every cell exactly once,
+        // or SetBody would build a board that contradicts itself.
+        std::vector<uint8_t> seen((size_t)cellTotal, 0);
+        for (const std::vector<int>* cells : {&bodyCells, &freeOrder}) {
+            for (int cell : *cells) {
+                if (cell < 0 || cell >= cellTotal || seen[cell]) { cursor.ok = false; return false; }
+                seen[cell] = 1;
+            }
+        }
+
+        sim.SetBody(bodyCells.data(), (int)bodyCells.size(), freeOrder.data(), (int)freeOrder.size());
+        sim.tick = tick;
+        sim.direction = (Direction)direction;
+        sim.growPending = (flags & 1) != 0;
+        sim.moved = (flags & 2) != 0;
+        sim.alive = (flags & 4) != 0;
+        sim.won = (flags & 8) != 0;
+        sim.score = score;
+        sim.rng.state = rngState;
+        sim.apple = Cell{apple % sim.config.cellCount, apple / sim.config.cellCount};
+        sim.vacatedTail = vacatedTail;
+        recordTick = tick;
+        return true;
+    }
+};
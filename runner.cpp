@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "simulation.h"
+#include "bots.h"
+#include "work_stealing_pool.h"
+
+// Plays many games with a bot across all cores and prints a summary of
+// scores, game lengths and throughput per board configuration.
+//
+//   snake_runner [--games N] [--threads N] [--bot random|greedy|autopilot]
+//                [--grids small,medium,large] [--walls on|off|both]
+//                [--seed N] [--max-ticks N] [--min-wins PERCENT]
+//
+// With --min-wins it exits with status 1 if any configuration won less than
+// that share of its games, so a bot's win rate can be checked from a script.
+//
+// Every game gets its own Simulation and seed; workers only write to their
+// own stats, so nothing mutable is shared on the hot path.
+
+using namespace std;
+
+struct BoardConfig {
+    const char* gridName;
+    int cellCount;
+    bool wallsEnabled;
+};
+
+struct RunnerOptions {
+    long long games = 100000;
+    int threads = 0;
+    const char* botName = "greedy";
+    BotFunction bot = GreedyBot;
+    vector<BoardConfig> boards;
+    uint64_t seed = 1;
+    long long maxTicks = 200000;
+    double minWins = -1.0;
+};
+
+struct ConfigStats {
+    long long games = 0;
+    long long wins = 0;
+    long long timeouts = 0;
+    long long ticks = 0;
+    long long totalScore = 0;
+    vector<long long> scoreCounts;
+    vector<int> lengths;
+
+    void Add(int score, long long gameTicks, bool won, bool timedOut) {
+        games++;
+        wins += won;
+        timeouts += timedOut;
+        ticks += gameTicks;
+        totalScore += score;
+        if ((int)scoreCounts.size() <= score) {
+            scoreCounts.resize(score + 1, 0);
+        }
+        scoreCounts[score]++;
+        lengths.push_back((int)gameTicks);
+    }
+
+    void Merge(const ConfigStats& other) {
+        games += other.games;
+        wins += other.wins;
+        timeouts += other.timeouts;
+        ticks += other.ticks;
+        totalScore += other.totalScore;
+        if (scoreCounts.size() < other.scoreCounts.size()) {
+            scoreCounts.resize(other.scoreCounts.size(), 0);
+        }
+        for (size_t i = 0; i < other.scoreCounts.size(); i++) {
+            scoreCounts[i] += other.scoreCounts[i];
+        }
+        lengths.insert(lengths.end(), other.lengths.begin(), other.lengths.end());
+    }
+
+    int ScorePercentile(double p) const {
+        long long target = (long long)(p * (games - 1));
+        long long seen = 0;
+        for (size_t score = 0; score < scoreCounts.size(); score++) {
+            seen += scoreCounts[score];
+            if (seen > target) {
+                return (int)score;
+            }
+        }
+        return 0;
+    }
+
+    int LengthPercentile(double p) {
+        if (lengths.empty()) {
+            return 0;
+        }
+        size_t k = (size_t)(p * (lengths.size() - 1));
+        nth_element(lengths.begin(), lengths.begin() + k, lengths.end());
+        return lengths[k];
+    }
+};
+
+// Per-worker results and reusable simulations, padded so neighbouring
+// workers never share a cache line.
+struct alignas(64) WorkerStats {
+    vector<ConfigStats> configs;
+    vector<Simulation> sims;
+};
+
+static bool ParseBoards(const char* grids, const char* walls, vector<BoardConfig>& boards) {
+    // Same sizes as Settings::GetCellCount.
+    static const BoardConfig sizes[] = {{"small", 15, true}, {"medium", 20, true}, {"large", 25, true}};
+    bool wallModes[2] = {strcmp(walls, "off") != 0, strcmp(walls, "on") != 0};
+    if (strcmp(walls, "on") != 0 && strcmp(walls, "off") != 0 && strcmp(walls, "both") != 0) {
+        fprintf(stderr, "--walls must be on, off or both\n");
+        return false;
+    }
+
+    string list = grids;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        string name = list.substr(start, comma == string::npos ? string::npos : comma - start);
+        const BoardConfig* size = nullptr;
+        for (const BoardConfig& candidate : sizes) {
+            if (name == candidate.gridName) size = &candidate;
+        }
+        if (size == nullptr) {
+            fprintf(stderr, "Unknown grid size '%s'\n", name.c_str());
+            return false;
+        }
+        if (wallModes[0]) boards.push_back(BoardConfig{size->gridName, size->cellCount, true});
+        if (wallModes[1]) boards.push_back(BoardConfig{size->gridName, size->cellCount, false});
+        if (comma == string::npos) break;
+        start = comma + 1;
+    }
+    return true;
+}
+
+static bool ParseOptions(int argc, char** argv, RunnerOptions& options) {
+    const char* grids = "small,medium,large";
+    const char* walls = "both";
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+        if (strcmp(arg, "--games") == 0) {
+            options.games = atoll(value);
+        } else if (strcmp(arg, "--threads") == 0) {
+            options.threads = atoi(value);
+        } else if (strcmp(arg, "--bot") == 0) {
+            options.botName = value;
+            options.bot = FindBot(value);
+            if (options.bot == nullptr) {
+                fprintf(stderr, "Unknown bot '%s'\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--grids") == 0) {
+            grids = value;
+        } else if (strcmp(arg, "--walls") == 0) {
+            walls = value;
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = strtoull(value, nullptr, 10);
+        } else if (strcmp(arg, "--max-ticks") == 0) {
+            options.maxTicks = atoll(value);
+        } else if (strcmp(arg, "--min-wins") == 0) {
+            options.minWins = atof(value);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+    if (options.threads <= 0) {
+        options.threads = (int)thread::hardware_concurrency();
+    }
+    // hardware_concurrency may not know; the pool would still run one
+    // thread, so the per-worker stats need at least that many.
+    if (options.threads <= 0) {
+        options.threads = 1;
+    }
+    return ParseBoards(grids, walls, options.boards);
+}
+
+// Mixes the run seed with the game number, so results do not depend on which
+// worker happened to play which game.
+static uint64_t GameSeed(uint64_t seed, long long game) {
+    Rng rng(seed ^ ((uint64_t)game * 0x9E3779B97F4A7C15ull));
+    return rng.Next();
+}
+
+static void PrintRow(const char* grid, const char* walls, ConfigStats& stats) {
+    double meanScore = stats.games > 0 ? (double)stats.totalScore / stats.games : 0.0;
+    double meanLength = stats.games > 0 ? (double)stats.ticks / stats.games : 0.0;
+    printf("%-8s %-5s %10lld %8.2f %5d %5d %5d %5d %10.1f %8d %8d %7lld %8lld\n",
+           grid, walls, stats.games, meanScore,
+           stats.ScorePercentile(0.5), stats.ScorePercentile(0.9), stats.ScorePercentile(0.99),
+           stats.scoreCounts.empty() ? 0 : (int)stats.scoreCounts.size() - 1,
+           meanLength, stats.LengthPercentile(0.5), stats.LengthPercentile(0.99),
+           stats.wins, stats.timeouts);
+}
+
+static void PrintHistogram(const ConfigStats& stats) {
+    const int buckets = 10;
+    int maxScore = stats.scoreCounts.empty() ? 0 : (int)stats.scoreCounts.size() - 1;
+    int width = maxScore / buckets + 1;
+    long long peak = 0;
+    vector<long long> counts(buckets, 0);
+    for (size_t score = 0; score < stats.scoreCounts.size(); score++) {
+        counts[score / width] += stats.scoreCounts[score];
+    }
+    for (long long count : counts) peak = max(peak, count);
+
+    printf("\nScore distribution (all configurations)\n");
+    for (int b = 0; b < buckets; b++) {
+        if (b * width > maxScore) break;
+        int bar = peak > 0 ? (int)(40 * counts[b] / peak) : 0;
+        printf("  %4d-%-4d %10lld %s\n", b * width, (b + 1) * width - 1, counts[b], string(bar, '#').c_str());
+    }
+}
+
+int main(int argc, char** argv) {
+    RunnerOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    int configCount = (int)options.boards.size();
+    vector<WorkerStats> workers(options.threads);
+    for (WorkerStats& worker : workers) {
+        worker.configs.resize(configCount);
+        worker.sims.resize(configCount);
+    }
+
+    WorkStealingPool pool(options.threads);
+    auto start = chrono::steady_clock::now();
+    pool.ParallelFor(options.games, 16, [&](int worker, long long game) {
+        int c = (int)(game % configCount);
+        const BoardConfig& board = options.boards[c];
+        SimConfig config;
+        config.cellCount = board.cellCount;
+        config.wallsEnabled = board.wallsEnabled;
+        config.seed = GameSeed(options.seed, game);
+
+        // Reusing the worker's simulation keeps its buffers, so starting a
+        // game does not allocate.
+        Simulation& sim = workers[worker].sims[c];
+        sim.Configure(config);
+        Rng botRng(config.seed ^ 0x5DEECE66Dull);
+        StepResult result = STEP_MOVED;
+        while (sim.alive && (long long)sim.tick < options.maxTicks) {
+            result = sim.Step(options.bot(sim, botRng));
+        }
+        workers[worker].configs[c].Add(sim.score, (long long)sim.tick,
+                                          result == STEP_WON, sim.alive);
+    });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ConfigStats total;
+    vector<ConfigStats> perConfig(configCount);
+    for (WorkerStats& worker : workers) {
+        for (int c = 0; c < configCount; c++) {
+            perConfig[c].Merge(worker.configs[c]);
+        }
+    }
+    for (const ConfigStats& stats : perConfig) {
+        total.Merge(stats);
+    }
+
+    printf("bot: %s   games: %lld   threads: %d   seed: %llu\n",
+           options.botName, options.games, options.threads, (unsigned long long)options.seed);
+    printf("elapsed: %.3f s   %.0f games/s   %.2f Mticks/s\n\n",
+           seconds, options.games / seconds, total.ticks / seconds / 1e6);
+    printf("%-8s %-5s %10s %8s %5s %5s %5s %5s %10s %8s %8s %7s %8s\n",
+           "grid", "walls", "games", "mean", "p50", "p90", "p99", "max",
+           "mean len", "p50 len", "p99 len", "wins", "timeouts");
+    for (int c = 0; c < configCount; c++) {
+        PrintRow(options.boards[c].gridName, options.boards[c].wallsEnabled ? "on" : "off", perConfig[c]);
+    }
+    PrintRow("all", "", total);
+    PrintHistogram(total);
+
+    int status = 0;
+    for (int c = 0; c < configCount; c++) {
+        const ConfigStats& stats = perConfig[c];
+        if (options.minWins >= 0 && stats.wins * 100.0 < options.minWins * stats.games) {
+            fprintf(stderr, "%s walls %s: won %lld of %lld games, below %.1f%%\n", options.boards[c].gridName,
+                    options.boards[c].wallsEnabled ? "on" : "off", stats.wins, stats.games, options.minWins);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -2,51 +2,63 @@
 #include "raylib.h"
 #include "globals.h"
 #include "ui.h"
+#include "text_cache.h"
+#include "profiler.h"
+#include "frame_pacer.h"
 #include <cstdio>
+#include <functional>
+
+// Menus, settings and the overlays are static apart from their widgets, so
+// they are drawn through one shared LayerCache (see ui.h). The key passed to
+// BeginStatic packs every value the static parts show.
+LayerCache screenCache;
+TextCache textCache;
+
+unsigned long long ScreenKey(int a, int b = 0, int c = 0, int d = 0) {
+    return ((unsigned long long)(unsigned short)a << 48) | ((unsigned long long)(unsigned short)b << 32) |
+           ((unsigned long long)(unsigned short)c << 16) | (unsigned long long)(unsigned short)d;
+}
 
 void DrawTitle(const char* title, int y, int fontSize, Color color) {
-    int textWidth = MeasureText(title, fontSize);
-    DrawText(title, (WINDOW_WIDTH - textWidth) / 2, y, fontSize, color);
+    const TextCache::Run& run = textCache.Layout(title, fontSize);
+    textCache.DrawRun(run, (float)((WINDOW_WIDTH - run.width) / 2), (float)y, color);
 }
 
 void DrawMenu(Button& startButton, Button& settingsButton, Button& exitButton, int highScore) {
-    ClearBackground(gameSettings.GetBackgroundColor());
-    
-    DrawTitle("Snake, The Snake Game", 100, 80, darkGreen);
-    
-    const char* subtitle = "Use arrow keys to move, SPACE to pause";
-    if (gameSettings.controls == WASD) {
-        subtitle = "Use WASD to move, SPACE to pause";
-    }
-    DrawTitle(subtitle, 180, 24, darkGreen);
-    
-    char highScoreText[50];
-    snprintf(highScoreText, sizeof(highScoreText), "High Score: %d", highScore);
-    DrawTitle(highScoreText, 220, 28, darkGreen);
-    
     startButton.Update();
     settingsButton.Update();
     exitButton.Update();
     
-    startButton.Draw();
-    settingsButton.Draw();
-    exitButton.Draw();
+    unsigned long long key = ScreenKey(highScore, gameSettings.controls, gameSettings.backgroundColorIndex);
+    if (screenCache.BeginStatic(MENU, key)) {
+        ClearBackground(gameSettings.GetBackgroundColor());
+        
+        DrawTitle("Snake, The Snake Game", 100, 80, darkGreen);
+        
+        const char* subtitle = "Use arrow keys to move, SPACE to pause";
+        if (gameSettings.controls == WASD) {
+            subtitle = "Use WASD to move, SPACE to pause";
+        }
+        DrawTitle(subtitle, 180, 24, darkGreen);
+        
+        char highScoreText[50];
+        snprintf(highScoreText, sizeof(highScoreText), "High Score: %d", highScore);
+        DrawTitle(highScoreText, 220, 28, darkGreen);
+        
+        DrawTitle("Press ENTER to Start, ESC to Exit", WINDOW_HEIGHT - 60, 16, gray);
+        screenCache.EndStatic();
+    }
     
-    DrawTitle("Press ENTER to Start, ESC to Exit", WINDOW_HEIGHT - 60, 16, gray);
+    screenCache.DrawWidget(startButton);
+    screenCache.DrawWidget(settingsButton);
+    screenCache.DrawWidget(exitButton);
+    screenCache.Present();
 }
 
 void DrawSettingsMenu(Button& backButton, Button& deleteHighScoreButton, SelectorButton& soundVolumeSelector, ToggleButton& wallsToggle,
                       SelectorButton& difficultySelector, SelectorButton& gridSelector,
                       SelectorButton& controlsSelector, ColorSelector& snakeColorSelector,
                       ColorSelector& bgColorSelector) {
-    ClearBackground(gameSettings.GetBackgroundColor());
-    
-    DrawTitle("Settings", 40, 60, darkGreen);
-    
-    Rectangle panelBg = {(float)(WINDOW_WIDTH/2 - 300), 100, 600, 680};
-    DrawRectangleRounded(panelBg, 0.05f, 6, Fade(white, 0.3f));
-    DrawRectangleRoundedLines(panelBg, 0.05f, 6, darkGreen);
-    
     soundVolumeSelector.Update();
     wallsToggle.Update();
     difficultySelector.Update();
@@ -57,140 +69,187 @@ void DrawSettingsMenu(Button& backButton, Button& deleteHighScoreButton, Selecto
     backButton.Update();
     deleteHighScoreButton.Update();
     
-    int leftCol = WINDOW_WIDTH/2 - 260;
-    int rightCol = WINDOW_WIDTH/2 + 20;
-    
-    DrawText("GAMEPLAY", leftCol, 130, 28, darkGreen);
-    DrawLine(leftCol, 158, leftCol + 240, 158, darkGreen);
-    
-    DrawText("Difficulty", leftCol, 170, 20, darkGreen);
-    difficultySelector.Draw();
-    
-    DrawText("Grid Size", leftCol, 245, 20, darkGreen);
-    gridSelector.Draw();
-    
-    DrawText("Walls", leftCol, 320, 20, darkGreen);
-    wallsToggle.Draw();
-    
-    DrawText("AUDIO & CONTROLS", rightCol, 130, 28, darkGreen);
-    DrawLine(rightCol, 158, rightCol + 240, 158, darkGreen);
-    
-    DrawText("Sound", rightCol, 170, 20, darkGreen);
-    soundVolumeSelector.Draw();
-    
-    DrawText("Controls", rightCol, 245, 20, darkGreen);
-    controlsSelector.Draw();
-    
-    int customTextWidth = MeasureText("CUSTOMIZATION", 28);
-    int customTextX = WINDOW_WIDTH/2 - customTextWidth/2;
-    DrawText("CUSTOMIZATION", customTextX, 480, 28, darkGreen);
-    DrawLine(WINDOW_WIDTH/2 - 140, 508, WINDOW_WIDTH/2 + 140, 508, darkGreen);
-    
-    DrawText("Snake Color", WINDOW_WIDTH/2 - 140, 520, 20, darkGreen);
-    snakeColorSelector.Draw();
-    
-    DrawText("Background Color", WINDOW_WIDTH/2 - 140, 595, 20, darkGreen);
-    bgColorSelector.Draw();
-    
-    DrawText("PREVIEW", WINDOW_WIDTH/2 - 50, 660, 20, darkGreen);
-    
-    Rectangle previewBg = {(float)(WINDOW_WIDTH/2 - 60), 685, 120, 60};
-    DrawRectangleRounded(previewBg, 0.2f, 4, gameSettings.GetBackgroundColor());
-    DrawRectangleRoundedLines(previewBg, 0.2f, 4, darkGreen);
-    
-    for (int i = 0; i < 3; i++) {
-        Rectangle seg = {(float)(WINDOW_WIDTH/2 - 40 + i * 25), 700, 20, 20};
-        DrawRectangleRounded(seg, 0.4f, 4, gameSettings.GetSnakeColor());
+    // The background and the preview follow the colour selectors.
+    unsigned long long key = ScreenKey(gameSettings.snakeColorIndex, gameSettings.backgroundColorIndex);
+    if (screenCache.BeginStatic(SETTINGS, key)) {
+        ClearBackground(gameSettings.GetBackgroundColor());
+        
+        DrawTitle("Settings", 40, 60, darkGreen);
+        
+        Rectangle panelBg = {(float)(WINDOW_WIDTH/2 - 300), 100, 600, 680};
+        DrawRectangleRounded(panelBg, 0.05f, 6, Fade(white, 0.3f));
+        DrawRectangleRoundedLines(panelBg, 0.05f, 6, darkGreen);
+        
+        int leftCol = WINDOW_WIDTH/2 - 260;
+        int rightCol = WINDOW_WIDTH/2 + 20;
+        
+        DrawText("GAMEPLAY", leftCol, 130, 28, darkGreen);
+        DrawLine(leftCol, 158, leftCol + 240, 158, darkGreen);
+        DrawText("Difficulty", leftCol, 170, 20, darkGreen);
+        DrawText("Grid Size", leftCol, 245, 20, darkGreen);
+        DrawText("Walls", leftCol, 320, 20, darkGreen);
+        
+        DrawText("AUDIO & CONTROLS", rightCol, 130, 28, darkGreen);
+        DrawLine(rightCol, 158, rightCol + 240, 158, darkGreen);
+        DrawText("Sound", rightCol, 170, 20, darkGreen);
+        DrawText("Controls", rightCol, 245, 20, darkGreen);
+        
+        int customTextWidth = MeasureText("CUSTOMIZATION", 28);
+        int customTextX = WINDOW_WIDTH/2 - customTextWidth/2;
+        DrawText("CUSTOMIZATION", customTextX, 480, 28, darkGreen);
+        DrawLine(WINDOW_WIDTH/2 - 140, 508, WINDOW_WIDTH/2 + 140, 508, darkGreen);
+        
+        DrawText("Snake Color", WINDOW_WIDTH/2 - 140, 520, 20, darkGreen);
+        DrawText("Background Color", WINDOW_WIDTH/2 - 140, 595, 20, darkGreen);
+        
+        DrawText("PREVIEW", WINDOW_WIDTH/2 - 50, 660, 20, darkGreen);
+        
+        Rectangle previewBg = {(float)(WINDOW_WIDTH/2 - 60), 685, 120, 60};
+        DrawRectangleRounded(previewBg, 0.2f, 4, gameSettings.GetBackgroundColor());
+        DrawRectangleRoundedLines(previewBg, 0.2f, 4, darkGreen);
+        
+        for (int i = 0; i < 3; i++) {
+            Rectangle seg = {(float)(WINDOW_WIDTH/2 - 40 + i * 25), 700, 20, 20};
+            DrawRectangleRounded(seg, 0.4f, 4, gameSettings.GetSnakeColor());
+        }
+        
+        DrawTitle("Press ESC or BACKSPACE to go back", WINDOW_HEIGHT - 40, 16, gray);
+        screenCache.EndStatic();
     }
     
-    deleteHighScoreButton.Draw();
-    backButton.Draw();
-    
-    DrawTitle("Press ESC or BACKSPACE to go back", WINDOW_HEIGHT - 40, 16, gray);
+    screenCache.DrawWidget(difficultySelector);
+    screenCache.DrawWidget(gridSelector);
+    screenCache.DrawWidget(wallsToggle);
+    screenCache.DrawWidget(soundVolumeSelector);
+    screenCache.DrawWidget(controlsSelector);
+    screenCache.DrawWidget(snakeColorSelector);
+    screenCache.DrawWidget(bgColorSelector);
+    screenCache.DrawWidget(deleteHighScoreButton);
+    screenCache.DrawWidget(backButton);
+    screenCache.Present();
 }
 
-void DrawPauseOverlay(Button& resumeButton, Button& restartButton, Button& settingsButton, Button& menuButton) {
-    DrawRectangle(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, Fade(BLACK, 0.7f));
-    
-    Rectangle panel = {(float)(WINDOW_WIDTH/2 - 150), 200, 300, 400};
-    DrawRectangleRounded(panel, 0.1f, 6, Fade(beige, 0.95f));
-    DrawRectangleRoundedLines(panel, 0.1f, 6, darkGreen);
-    
-    DrawTitle("PAUSED", 230, 40, darkGreen);
-    
+// The game is frozen behind the overlays, so drawScene (the board as it was
+// left) goes into the static layer with the panel on top.
+void DrawPauseOverlay(Button& resumeButton, Button& restartButton, Button& settingsButton, Button& menuButton,
+                      const std::function<void()>& drawScene, int score) {
     resumeButton.Update();
     restartButton.Update();
     settingsButton.Update();
     menuButton.Update();
     
-    resumeButton.Draw();
-    restartButton.Draw();
-    settingsButton.Draw();
-    menuButton.Draw();
+    if (screenCache.BeginStatic(PAUSED, ScreenKey(score))) {
+        drawScene();
+        DrawRectangle(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, Fade(BLACK, 0.7f));
+        
+        Rectangle panel = {(float)(WINDOW_WIDTH/2 - 150), 200, 300, 400};
+        DrawRectangleRounded(panel, 0.1f, 6, Fade(beige, 0.95f));
+        DrawRectangleRoundedLines(panel, 0.1f, 6, darkGreen);
+        
+        DrawTitle("PAUSED", 230, 40, darkGreen);
+        DrawTitle("Press SPACE to Resume", 560, 16, gray);
+        screenCache.EndStatic();
+    }
     
-    DrawTitle("Press SPACE to Resume", 560, 16, gray);
+    screenCache.DrawWidget(resumeButton);
+    screenCache.DrawWidget(restartButton);
+    screenCache.DrawWidget(settingsButton);
+    screenCache.DrawWidget(menuButton);
+    screenCache.Present();
 }
 
-void DrawGameOver(Button& restartButton, Button& menuButton, int score, int highScore) {
-    DrawRectangle(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, Fade(BLACK, 0.7f));
-    
-    Rectangle panel = {(float)(WINDOW_WIDTH/2 - 180), 200, 360, 350};
-    DrawRectangleRounded(panel, 0.1f, 6, Fade(beige, 0.95f));
-    DrawRectangleRoundedLines(panel, 0.1f, 6, darkGreen);
-    
-    DrawTitle("GAME OVER", 230, 45, red);
-    
-    char scoreText[50];
-    snprintf(scoreText, sizeof(scoreText), "Score: %d", score);
-    DrawTitle(scoreText, 300, 30, darkGreen);
-    
-    char highScoreText[50];
-    snprintf(highScoreText, sizeof(highScoreText), "High Score: %d", highScore);
-    DrawTitle(highScoreText, 340, 24, gray);
-    
+void DrawGameOver(Button& restartButton, Button& menuButton, const std::function<void()>& drawScene,
+                  int score, int highScore, bool won) {
     restartButton.Update();
     menuButton.Update();
     
-    restartButton.Draw();
-    menuButton.Draw();
+    if (screenCache.BeginStatic(GAME_OVER, ScreenKey(score, highScore, won))) {
+        drawScene();
+        DrawRectangle(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, Fade(BLACK, 0.7f));
+        
+        Rectangle panel = {(float)(WINDOW_WIDTH/2 - 180), 200, 360, 350};
+        DrawRectangleRounded(panel, 0.1f, 6, Fade(beige, 0.95f));
+        DrawRectangleRoundedLines(panel, 0.1f, 6, darkGreen);
+        
+        if (won) {
+            DrawTitle("YOU WIN!", 230, 45, darkGreen);
+        } else {
+            DrawTitle("GAME OVER", 230, 45, red);
+        }
+        
+        char scoreText[50];
+        snprintf(scoreText, sizeof(scoreText), "Score: %d", score);
+        DrawTitle(scoreText, 300, 30, darkGreen);
+        
+        char highScoreText[50];
+        snprintf(highScoreText, sizeof(highScoreText), "High Score: %d", highScore);
+        DrawTitle(highScoreText, 340, 24, gray);
+        
+        DrawTitle("Press R to Restart, ESC for Menu", 520, 16, gray);
+        screenCache.EndStatic();
+    }
     
-    DrawTitle("Press R to Restart, ESC for Menu", 520, 16, gray);
+    screenCache.DrawWidget(restartButton);
+    screenCache.DrawWidget(menuButton);
+    screenCache.Present();
 }
 
-void DrawGameUI(int score, int highScore, bool isPaused) {
+void DrawGameUI(int score, int highScore, bool isPaused, bool autopilot) {
     int offsetX = GetGameOffsetX();
     int offsetY = GetGameOffsetY();
-    int gameWidth = cellSize * cellCount;
-    int gameHeight = cellSize * cellCount;
+    int gameWidth = GetBoardViewSize();
+    int gameHeight = GetBoardViewSize();
     
     DrawRectangleLinesEx(Rectangle{(float)(offsetX - 5), (float)(offsetY - 5),
                                    (float)(gameWidth + 10), (float)(gameHeight + 10)}, 
                          5, darkGreen);
     
-    const char* title = "Snake, The Snake Game";
-    int titleWidth = MeasureText(title, 35);
-    DrawText(title, (WINDOW_WIDTH - titleWidth) / 2, 20, 35, darkGreen);
+    DrawTitle("Snake, The Snake Game", 20, 35, darkGreen);
     
-    char scoreText[50];
-    snprintf(scoreText, sizeof(scoreText), "Score: %d", score);
-    DrawText(scoreText, offsetX, offsetY + gameHeight + 15, 30, darkGreen);
+    // Strings are only re-formatted when their value changes, and the text
+    // cache keeps their layout, so a steady HUD does no text work per frame.
+    static HudLabel scoreLabel, highScoreLabel, difficultyLabel;
+    const char* scoreText = scoreLabel.Format("Score: %d", score);
+    textCache.Draw(scoreText, offsetX, offsetY + gameHeight + 15, 30, darkGreen);
     
-    char highScoreText[50];
-    snprintf(highScoreText, sizeof(highScoreText), "High Score: %d", highScore);
-    int hsWidth = MeasureText(highScoreText, 24);
-    DrawText(highScoreText, offsetX + gameWidth - hsWidth, offsetY + gameHeight + 20, 24, gray);
+    const TextCache::Run& highScoreRun = textCache.Layout(highScoreLabel.Format("High Score: %d", highScore), 24);
+    textCache.DrawRun(highScoreRun, (float)(offsetX + gameWidth - highScoreRun.width), (float)(offsetY + gameHeight + 20), gray);
     
-    char diffText[30];
-    snprintf(diffText, sizeof(diffText), "Difficulty: %s", gameSettings.GetDifficultyName());
-    DrawText(diffText, 20, 60, 16, darkGreen);
+    const char* diffText = difficultyLabel.Format("Difficulty: %s", gameSettings.GetDifficultyName());
+    textCache.Draw(diffText, 20, 60, 16, darkGreen);
     
     const char* wallText = gameSettings.wallsEnabled ? "Walls: ON" : "Walls: OFF";
-    int wallWidth = MeasureText(wallText, 16);
-    DrawText(wallText, WINDOW_WIDTH - wallWidth - 20, 60, 16, darkGreen);
+    const TextCache::Run& wallRun = textCache.Layout(wallText, 16);
+    textCache.DrawRun(wallRun, (float)(WINDOW_WIDTH - wallRun.width - 20), 60, darkGreen);
     
     const char* controlHint = gameSettings.controls == ARROW_KEYS ? 
                               "Arrow Keys to move | SPACE: Pause | ESC: Menu" :
                               "WASD to move | SPACE: Pause | ESC: Menu";
-    int hintWidth = MeasureText(controlHint, 14);
-    DrawText(controlHint, (WINDOW_WIDTH - hintWidth) / 2, WINDOW_HEIGHT - 30, 14, gray);
+    if (autopilot) {
+        controlHint = "Autopilot | F2: Take over | SPACE: Pause | ESC: Menu";
+    }
+    DrawTitle(controlHint, WINDOW_HEIGHT - 30, 14, gray);
+}
+
+// Live numbers from the frame profiler (F3). Times are in milliseconds over
+// the last few hundred frames.
+void DrawProfilerOverlay() {
+    const Profiler::Stats& stats = profiler.stats;
+    const FramePacer::Stats& pacing = framePacer.stats;
+    char lines[ZONE_COUNT + 5][64];
+    int count = 0;
+    snprintf(lines[count++], 64, "frame p50 %.2f  p99 %.2f  max %.2f", stats.frameP50, stats.frameP99, stats.frameMax);
+    snprintf(lines[count++], 64, "tick jitter p50 %.2f  p99 %.2f", stats.jitterP50, stats.jitterP99);
+    snprintf(lines[count++], 64, "pacing %d fps  err p99 %.2f  max %.2f  late %lld", framePacer.Target(),
+             pacing.errorP99, pacing.errorMax, pacing.lateFrames);
+    snprintf(lines[count++], 64, "draws %d  trace drops %lld", stats.draws, stats.dropped);
+    for (int zone = ZONE_AUDIO; zone < ZONE_COUNT; zone++) {
+        snprintf(lines[count++], 64, "%-10s %.3f", PROFILE_ZONE_NAMES[zone], stats.zoneMean[zone]);
+    }
+    
+    int lineHeight = 16;
+    DrawRectangle(8, 8, 330, count * lineHeight + 12, Fade(BLACK, 0.75f));
+    for (int i = 0; i < count; i++) {
+        DrawText(lines[i], 16, 14 + i * lineHeight, 12, WHITE);
+    }
 }
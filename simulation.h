@@ -0,0 +1,431 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Pure game rules. Nothing in here may depend on raylib, so the simulation can
+// run without a window or audio device (see headless.cpp).
+
+enum Direction {
+    DIR_NONE,
+    DIR_UP,
+    DIR_DOWN,
+    DIR_LEFT,
+    DIR_RIGHT
+};
+
+enum StepResult {
+    STEP_MOVED,
+    STEP_ATE,
+    STEP_DIED,
+    STEP_WON
+};
+
+struct Cell {
+    int x;
+    int y;
+
+    bool operator==(const Cell& other) const { return x == other.x && y == other.y; }
+    bool operator!=(const Cell& other) const { return !(*this == other); }
+};
+
+inline Cell DirectionDelta(Direction dir) {
+    switch (dir) {
+        case DIR_UP: return Cell{0, -1};
+        case DIR_DOWN: return Cell{0, 1};
+        case DIR_LEFT: return Cell{-1, 0};
+        case DIR_RIGHT: return Cell{1, 0};
+        default: return Cell{0, 0};
+    }
+}
+
+inline bool IsOppositeDirection(Direction a, Direction b) {
+    Cell da = DirectionDelta(a);
+    Cell db = DirectionDelta(b);
+    return da.x == -db.x && da.y == -db.y && (da.x != 0 || da.y != 0);
+}
+
+// xorshift64* seeded through splitmix64; small, fast and identical on every
+// platform, unlike GetRandomValue.
+class Rng {
+public:
+    uint64_t state = 1;
+
+    explicit Rng(uint64_t seed = 1) {
+        Seed(seed);
+    }
+
+    void Seed(uint64_t seed) {
+        uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        state = (z ^ (z >> 31)) | 1;
+    }
+
+    uint64_t Next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    int Below(int bound) {
+        return (int)(((Next() >> 32) * (uint64_t)bound) >> 32);
+    }
+};
+
+// Set of free cell indices with O(1) insert, remove and uniform random pick:
+// a dense array of members plus each cell's slot in it.
+class FreeCellSet {
+public:
+    std::vector<int> cells;
+    std::vector<int> slots;
+
+    void Reset(int cellTotal) {
+        cells.resize(cellTotal);
+        slots.resize(cellTotal);
+        for (int i = 0; i < cellTotal; i++) {
+            cells[i] = i;
+            slots[i] = i;
+        }
+    }
+
+    int Size() const {
+        return (int)cells.size();
+    }
+
+    bool Contains(int cell) const {
+        return slots[cell] >= 0;
+    }
+
+    void Insert(int cell) {
+        if (slots[cell] >= 0) {
+            return;
+        }
+        slots[cell] = (int)cells.size();
+        cells.push_back(cell);
+    }
+
+    void Remove(int cell) {
+        int slot = slots[cell];
+        if (slot < 0) {
+            return;
+        }
+        int last = cells.back();
+        cells[slot] = last;
+        slots[last] = slot;
+        cells.pop_back();
+        slots[cell] = -1;
+    }
+
+    int Pick(Rng& rng) const {
+        return cells[rng.Below((int)cells.size())];
+    }
+};
+
+// Ring buffer holding the body as packed cell indices (y * cellCount + x),
+// head first. Boards up to 256x256 get room for a full-board snake up front,
+// so moving never allocates; bigger boards start with that much and double
+// as the snake outgrows it.
+class SnakeBody {
+public:
+    static const int MAX_CELLS = 4096 * 4096;
+    static const int PREALLOCATED_CELLS = 65536;
+
+    std::vector<uint32_t> cells;
+    int width = 0;
+    int maxLength = 0;
+    int first = 0;
+    int length = 0;
+
+    class Iterator {
+    public:
+        const SnakeBody* body;
+        int position;
+
+        Cell operator*() const { return (*body)[position]; }
+        Iterator& operator++() { position++; return *this; }
+        bool operator!=(const Iterator& other) const { return position != other.position; }
+    };
+
+    void Reset(int cellCount) {
+        width = cellCount;
+        maxLength = cellCount * cellCount;
+        cells.resize((size_t)(maxLength < PREALLOCATED_CELLS ? maxLength : PREALLOCATED_CELLS));
+        first = 0;
+        length = 0;
+    }
+
+    int Size() const {
+        return length;
+    }
+
+    int Capacity() const {
+        return (int)cells.size();
+    }
+
+    int IndexAt(int position) const {
+        int slot = first + position;
+        if (slot >= Capacity()) slot -= Capacity();
+        return (int)cells[slot];
+    }
+
+    Cell operator[](int position) const {
+        int index = IndexAt(position);
+        return Cell{index % width, index / width};
+    }
+
+    Cell Front() const {
+        return (*this)[0];
+    }
+
+    Cell Back() const {
+        return (*this)[length - 1];
+    }
+
+    void PushFront(int index) {
+        if (length == Capacity()) Grow();
+        first = first == 0 ? Capacity() - 1 : first - 1;
+        cells[first] = (uint32_t)index;
+        length++;
+    }
+
+    void PushBack(int index) {
+        if (length == Capacity()) Grow();
+        int slot = first + length;
+        if (slot >= Capacity()) slot -= Capacity();
+        cells[slot] = (uint32_t)index;
+        length++;
+    }
+
+    void PopBack() {
+        length--;
+    }
+
+    Iterator begin() const { return Iterator{this, 0}; }
+    Iterator end() const { return Iterator{this, length}; }
+
+private:
+    // Unrolls the ring into a buffer twice the size (capped at the board).
+    void Grow() {
+        int capacity = Capacity() * 2 < maxLength ? Capacity() * 2 : maxLength;
+        std::vector<uint32_t> grown((size_t)capacity);
+        for (int i = 0; i < length; i++) {
+            grown[i] = (uint32_t)IndexAt(i);
+        }
+        cells.swap(grown);
+        first = 0;
+    }
+};
+
+struct SimConfig {
+    // At most 4096 (SnakeBody::MAX_CELLS cells).
+    int cellCount = 20;
+    bool wallsEnabled = true;
+    uint64_t seed = 1;
+};
+
+class Simulation {
+public:
+    SimConfig config;
+    SnakeBody body;
+    // One byte per cell, set while a body segment covers it. Updated as the
+    // head is pushed and the tail popped, so collision checks are O(1).
+    std::vector<uint8_t> occupied;
+    // Every cell not covered by the body; apples spawn from here.
+    FreeCellSet freeCells;
+    Direction direction = DIR_RIGHT;
+    Cell apple = {0, 0};
+    bool growPending = false;
+    // What the last Step did to the body, so renderers can interpolate
+    // between ticks: moved is false after a reset or a fatal step, and
+    // vacatedTail is the cell the tail left (-1 if the snake grew instead).
+    bool moved = false;
+    int vacatedTail = -1;
+    bool alive = true;
+    bool won = false;
+    int score = 0;
+    uint64_t tick = 0;
+    Rng rng;
+
+    explicit Simulation(SimConfig cfg = SimConfig()) : config(cfg) {
+        Reset(config.seed);
+    }
+
+    void Configure(SimConfig cfg) {
+        config = cfg;
+        Reset(config.seed);
+    }
+
+    void Reset(uint64_t seed) {
+        config.seed = seed;
+        rng.Seed(seed);
+
+        int startX = config.cellCount / 4;
+        int startY = config.cellCount / 2;
+        body.Reset(config.cellCount);
+        occupied.assign((size_t)config.cellCount * config.cellCount, 0);
+        freeCells.Reset(config.cellCount * config.cellCount);
+        for (int i = 0; i < 3; i++) {
+            int index = CellIndex(Cell{startX + i, startY});
+            body.PushFront(index);
+            occupied[index] = 1;
+            freeCells.Remove(index);
+        }
+        direction = DIR_RIGHT;
+        growPending = false;
+        moved = false;
+        vacatedTail = -1;
+        alive = true;
+        won = false;
+        score = 0;
+        tick = 0;
+        apple = RandomFreeCell();
+    }
+
+    // Replaces the body (cell indices, head first) and rebuilds occupancy
+    // and the free-cell index. freeOrder restores the index's exact order,
+    // which later apple picks depend on; pass nullptr to list free cells in
+    // ascending order. Other fields are left to the caller.
+    void SetBody(const int* cells, int length, const int* freeOrder, int freeCount) {
+        int cellTotal = config.cellCount * config.cellCount;
+        body.Reset(config.cellCount);
+        occupied.assign((size_t)cellTotal, 0);
+        for (int i = length - 1; i >= 0; i--) {
+            body.PushFront(cells[i]);
+            occupied[cells[i]] = 1;
+        }
+
+        freeCells.cells.clear();
+        freeCells.slots.assign((size_t)cellTotal, -1);
+        if (freeOrder != nullptr) {
+            for (int i = 0; i < freeCount; i++) {
+                freeCells.Insert(freeOrder[i]);
+            }
+        } else {
+            for (int i = 0; i < cellTotal; i++) {
+                if (!occupied[i]) freeCells.Insert(i);
+            }
+        }
+    }
+
+    Cell Head() const {
+        return body.Front();
+    }
+
+    bool CanTurn(Direction dir) const {
+        return dir != DIR_NONE && !IsOppositeDirection(dir, direction);
+    }
+
+    // Advances the game by one tick. A reversing or DIR_NONE input keeps the
+    // current heading.
+    StepResult Step(Direction input = DIR_NONE) {
+        if (!alive) {
+            return won ? STEP_WON : STEP_DIED;
+        }
+        if (CanTurn(input)) {
+            direction = input;
+        }
+        tick++;
+        moved = false;
+        vacatedTail = -1;
+
+        Cell delta = DirectionDelta(direction);
+        Cell head = Cell{Head().x + delta.x, Head().y + delta.y};
+
+        if (config.wallsEnabled) {
+            if (head.x >= config.cellCount || head.x < 0 || head.y >= config.cellCount || head.y < 0) {
+                alive = false;
+                return STEP_DIED;
+            }
+        } else {
+            if (head.x >= config.cellCount) head.x = 0;
+            else if (head.x < 0) head.x = config.cellCount - 1;
+            if (head.y >= config.cellCount) head.y = 0;
+            else if (head.y < 0) head.y = config.cellCount - 1;
+        }
+
+        // The tail moves out of the way before the head moves in, so following
+        // your own tail closely is allowed.
+        int tail = body.IndexAt(body.Size() - 1);
+        bool grew = growPending;
+        if (grew) {
+            growPending = false;
+        } else {
+            body.PopBack();
+            occupied[tail] = 0;
+            freeCells.Insert(tail);
+        }
+
+        int headIndex = CellIndex(head);
+        if (occupied[headIndex]) {
+            if (!grew) {
+                body.PushBack(tail);
+                occupied[tail] = 1;
+                freeCells.Remove(tail);
+            }
+            alive = false;
+            return STEP_DIED;
+        }
+        body.PushFront(headIndex);
+        occupied[headIndex] = 1;
+        freeCells.Remove(headIndex);
+        moved = true;
+        vacatedTail = grew ? -1 : tail;
+
+        if (head == apple) {
+            growPending = true;
+            score++;
+            if (freeCells.Size() == 0) {
+                // The body covers the whole board: nowhere left to put food.
+                alive = false;
+                won = true;
+                return STEP_WON;
+            }
+            apple = RandomFreeCell();
+            return STEP_ATE;
+        }
+        return STEP_MOVED;
+    }
+
+    // Where the head would land after moving one cell in dir. Returns false
+    // if that leaves the board with walls enabled.
+    bool NextCell(Direction dir, Cell& next) const {
+        Cell delta = DirectionDelta(dir);
+        next = Cell{Head().x + delta.x, Head().y + delta.y};
+        int n = config.cellCount;
+        if (!config.wallsEnabled) {
+            next.x = (next.x + n) % n;
+            next.y = (next.y + n) % n;
+            return true;
+        }
+        return next.x >= 0 && next.y >= 0 && next.x < n && next.y < n;
+    }
+
+    // True if moving in dir this tick does not end the game. The tail cell
+    // counts as free unless the snake is about to grow.
+    bool IsSafeMove(Direction dir) const {
+        Cell next;
+        if (!NextCell(dir, next)) {
+            return false;
+        }
+        if (!IsOccupied(next)) {
+            return true;
+        }
+        return !growPending && next == body.Back();
+    }
+
+    int CellIndex(Cell cell) const {
+        return cell.y * config.cellCount + cell.x;
+    }
+
+    bool IsOccupied(Cell cell) const {
+        return occupied[CellIndex(cell)] != 0;
+    }
+
+    // Uniform over free cells; only valid while at least one is free.
+    Cell RandomFreeCell() {
+        int index = freeCells.Pick(rng);
+        return Cell{index % config.cellCount, index / config.cellCount};
+    }
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Fixed-size ring for one producer and one consumer, without locks. Push
+// never blocks: when the consumer falls behind it returns false and the
+// producer decides what to do with the item (the profiler counts it as
+// dropped).
+template <typename T, int CAPACITY>
+class SpscRing {
+public:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+    bool Push(const T& item) {
+        uint32_t head = writeIndex.load(std::memory_order_relaxed);
+        if (head - readIndex.load(std::memory_order_acquire) == (uint32_t)CAPACITY) {
+            return false;
+        }
+        items[head & (CAPACITY - 1)] = item;
+        writeIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T& item) {
+        uint32_t tail = readIndex.load(std::memory_order_relaxed);
+        if (tail == writeIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[tail & (CAPACITY - 1)];
+        readIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[CAPACITY];
+    alignas(64) std::atomic<uint32_t> writeIndex{0};
+    alignas(64) std::atomic<uint32_t> readIndex{0};
+};
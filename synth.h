@@ -0,0 +1,227 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+#include "spsc_ring.h"
+
+// Every sound in the game, synthesised as it plays: the eat, game over and
+// click effects and the looping music, in the 8-bit style the old
+// pre-rendered WAVs had. Render is called from the audio device's callback
+// and fills the output a buffer at a time, so no samples are stored
+// anywhere. Nothing in here depends on raylib.
+//
+// The game thread talks to it only through a lock-free command ring (Play,
+// SetVolumes, SetMusic, SetScore each push one command); Render drains the
+// ring at the start of every buffer, so all mixing state belongs to the
+// audio thread. Effects play on a fixed pool of voices, so quick repeats
+// overlap instead of cutting each other off. When every voice is busy, the
+// one nearest its end is stolen; every effect fades out, so that is the
+// quietest. As the score climbs, the music speeds up and everything eaten
+// rises in pitch.
+
+enum SynthEffect {
+    EFFECT_EAT,
+    EFFECT_GAME_OVER,
+    EFFECT_CLICK,
+    EFFECT_COUNT
+};
+
+enum AudioCommandType {
+    AUDIO_PLAY,
+    AUDIO_VOLUMES,
+    AUDIO_MUSIC,
+    AUDIO_SCORE
+};
+
+struct AudioCommand {
+    AudioCommandType type;
+    // AUDIO_PLAY: the effect. AUDIO_MUSIC: 1 to play. AUDIO_SCORE: the score.
+    int value;
+    // AUDIO_VOLUMES only.
+    float effects;
+    float music;
+};
+
+class Synth {
+public:
+    static const int SAMPLE_RATE = 44100;
+    static const int MAX_VOICES = 8;
+
+    // Commands the ring had no room for. Game thread only.
+    int droppedCommands = 0;
+
+    void Play(SynthEffect effect) {
+        Send(AudioCommand{AUDIO_PLAY, effect, 0.0f, 0.0f});
+    }
+
+    void SetVolumes(float effects, float music) {
+        Send(AudioCommand{AUDIO_VOLUMES, 0, effects, music});
+    }
+
+    void SetMusic(bool playing) {
+        Send(AudioCommand{AUDIO_MUSIC, playing ? 1 : 0, 0.0f, 0.0f});
+    }
+
+    void SetScore(int score) {
+        Send(AudioCommand{AUDIO_SCORE, score, 0.0f, 0.0f});
+    }
+
+    // Audio thread only. Writes frames mono 16-bit samples.
+    void Render(int16_t* out, int frames) {
+        AudioCommand command;
+        while (commands.Pop(command)) {
+            Apply(command);
+        }
+        for (int f = 0; f < frames; f++) {
+            float value = 0.0f;
+            for (Voice& voice : voices) {
+                if (voice.active) value += Effect(voice);
+            }
+            value *= effectVolume;
+            if (musicPlaying && musicVolume > 0.0f) {
+                value += Music() * musicVolume;
+            }
+            if (value > 1.0f) value = 1.0f;
+            if (value < -1.0f) value = -1.0f;
+            out[f] = (int16_t)(value * 32767.0f);
+        }
+    }
+
+private:
+    struct Voice {
+        bool active = false;
+        SynthEffect effect = EFFECT_EAT;
+        int sample = 0;
+        int length = 0;
+        float phase = 0.0f;
+        float pitch = 1.0f;
+    };
+
+    static const int MELODY_NOTES = 8;
+    // C D E D C A B C, 1.25 s each at the starting tempo.
+    static constexpr float MELODY[MELODY_NOTES] = {523, 587, 659, 587, 523, 440, 494, 523};
+    static constexpr float NOTE_SECONDS = 1.25f;
+    static constexpr float EFFECT_SECONDS[EFFECT_COUNT] = {0.15f, 0.8f, 0.08f};
+
+    SpscRing<AudioCommand, 256> commands;
+
+    // Owned by the audio thread.
+    Voice voices[MAX_VOICES];
+    float effectVolume = 0.0f;
+    float musicVolume = 0.0f;
+    bool musicPlaying = false;
+    float pitch = 1.0f;
+    float tempo = 1.0f;
+    int note = 0;
+    float noteProgress = 0.0f;
+    float melodyPhase = 0.0f;
+    float bassPhase = 0.0f;
+
+    void Send(const AudioCommand& command) {
+        if (!commands.Push(command)) {
+            droppedCommands++;
+        }
+    }
+
+    void Apply(const AudioCommand& command) {
+        switch (command.type) {
+            case AUDIO_PLAY:
+                Start((SynthEffect)command.value);
+                break;
+            case AUDIO_VOLUMES:
+                effectVolume = command.effects;
+                musicVolume = command.music;
+                break;
+            case AUDIO_MUSIC:
+                musicPlaying = command.value != 0;
+                break;
+            case AUDIO_SCORE: {
+                // A semitone every five points, up to an octave, and up to
+                // half as fast again for the music.
+                int score = command.value < 0 ? 0 : command.value;
+                pitch = exp2f((score / 5 < 12 ? score / 5 : 12) / 12.0f);
+                tempo = 1.0f + (score < 100 ? score : 100) / 200.0f;
+                break;
+            }
+        }
+    }
+
+    void Start(SynthEffect effect) {
+        Voice* chosen = &voices[0];
+        for (Voice& voice : voices) {
+            if (!voice.active) {
+                chosen = &voice;
+                break;
+            }
+            if ((float)voice.sample / voice.length > (float)chosen->sample / chosen->length) {
+                chosen = &voice;
+            }
+        }
+        *chosen = Voice();
+        chosen->active = true;
+        chosen->effect = effect;
+        chosen->length = (int)(SAMPLE_RATE * EFFECT_SECONDS[effect]);
+        chosen->pitch = effect == EFFECT_EAT ? pitch : 1.0f;
+    }
+
+    // One sample of the voice's effect; frees the voice at the end.
+    static float Effect(Voice& voice) {
+        float p = (float)voice.sample / voice.length;
+        if (++voice.sample >= voice.length) {
+            voice.active = false;
+        }
+        switch (voice.effect) {
+            case EFFECT_EAT: return Eat(voice, p);
+            case EFFECT_GAME_OVER: return GameOver(voice, p);
+            default: return Click(voice, p);
+        }
+    }
+
+    // Moves phase on by one sample of frequency and returns where in the
+    // cycle it is, in [0, 1).
+    static float Advance(float& phase, float frequency) {
+        phase += frequency / SAMPLE_RATE;
+        phase -= floorf(phase);
+        return phase;
+    }
+
+    static float Square(float cycle, float amplitude) {
+        return cycle < 0.5f ? amplitude : -amplitude;
+    }
+
+    // Square wave sweeping up from 400 to 1000 Hz, fading out linearly.
+    static float Eat(Voice& voice, float p) {
+        float cycle = Advance(voice.phase, (400.0f + p * 600.0f) * voice.pitch);
+        return Square(cycle, 0.4f) * (1.0f - p);
+    }
+
+    // Triangle wave falling from 300 to 100 Hz, with a long tail.
+    static float GameOver(Voice& voice, float p) {
+        float cycle = Advance(voice.phase, 300.0f - p * 200.0f);
+        return 0.4f * (fabsf(cycle - 0.5f) * 4.0f - 1.0f) * (1.0f - powf(p, 0.3f));
+    }
+
+    // A short 800 Hz square blip.
+    static float Click(Voice& voice, float p) {
+        float cycle = Advance(voice.phase, 800.0f);
+        return Square(cycle, 0.3f) * (1.0f - sqrtf(p));
+    }
+
+    // The melody in squares with a bass an octave down, each note ramping
+    // in and out over its first and last tenth.
+    float Music() {
+        float frequency = MELODY[note] * pitch;
+        float value = Square(Advance(melodyPhase, frequency), 0.2f) + Square(Advance(bassPhase, frequency * 0.5f), 0.1f);
+        float envelope = 1.0f;
+        if (noteProgress < 0.1f) envelope = noteProgress / 0.1f;
+        else if (noteProgress > 0.9f) envelope = (1.0f - noteProgress) / 0.1f;
+        noteProgress += tempo / (NOTE_SECONDS * SAMPLE_RATE);
+        if (noteProgress >= 1.0f) {
+            noteProgress -= 1.0f;
+            note = (note + 1) % MELODY_NOTES;
+        }
+        return value * envelope;
+    }
+};
+
+inline Synth synth;
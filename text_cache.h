@@ -0,0 +1,171 @@
+#pragma once
+#include "raylib.h"
+#include "rlgl.h"
+#include "profiler.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Laid-out strings keyed by text, font size and font. A run keeps the
+// measured width and the quad of every glyph, so drawing a cached string is a
+// single batched submission: no UTF-8 decoding, glyph lookups or measuring
+// after the first time it is seen. Runs not used for a while are evicted once
+// there are more than maxRuns, so changing strings like the score do not
+// pile up.
+class TextCache {
+public:
+    struct Glyph {
+        Rectangle source;
+        Rectangle dest;
+    };
+
+    struct Run {
+        Font font;
+        int width = 0;
+        int height = 0;
+        std::vector<Glyph> glyphs;
+        unsigned long long lastUsed = 0;
+    };
+
+    size_t maxRuns = 256;
+
+    // Same metrics as MeasureText/DrawText with the default font.
+    const Run& Layout(const char* text, int fontSize) {
+        if (fontSize < 10) fontSize = 10;
+        return Layout(GetFontDefault(), text, (float)fontSize, (float)(fontSize / 10));
+    }
+
+    const Run& Layout(Font font, const char* text, float fontSize, float spacing) {
+        key.assign(text);
+        key.push_back('\0');
+        key.append((const char*)&fontSize, sizeof(fontSize));
+        key.append((const char*)&spacing, sizeof(spacing));
+        key.append((const char*)&font.texture.id, sizeof(font.texture.id));
+
+        useCounter++;
+        auto found = runs.find(key);
+        if (found != runs.end()) {
+            found->second.lastUsed = useCounter;
+            return found->second;
+        }
+        if (runs.size() >= maxRuns) {
+            EvictOldest();
+        }
+        Run& run = runs[key];
+        BuildRun(run, font, text, fontSize, spacing);
+        run.lastUsed = useCounter;
+        return run;
+    }
+
+    int Width(const char* text, int fontSize) {
+        return Layout(text, fontSize).width;
+    }
+
+    void Draw(const char* text, int x, int y, int fontSize, Color color) {
+        DrawRun(Layout(text, fontSize), (float)x, (float)y, color);
+    }
+
+    void DrawRun(const Run& run, float x, float y, Color color) {
+        if (run.glyphs.empty()) {
+            return;
+        }
+        float textureWidth = (float)run.font.texture.width;
+        float textureHeight = (float)run.font.texture.height;
+        rlCheckRenderBatchLimit(4 * (int)run.glyphs.size());
+        rlSetTexture(run.font.texture.id);
+        rlBegin(RL_QUADS);
+        rlColor4ub(color.r, color.g, color.b, color.a);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        for (const Glyph& glyph : run.glyphs) {
+            float u0 = glyph.source.x / textureWidth;
+            float v0 = glyph.source.y / textureHeight;
+            float u1 = (glyph.source.x + glyph.source.width) / textureWidth;
+            float v1 = (glyph.source.y + glyph.source.height) / textureHeight;
+            float left = x + glyph.dest.x;
+            float top = y + glyph.dest.y;
+            rlTexCoord2f(u0, v0); rlVertex2f(left, top);
+            rlTexCoord2f(u0, v1); rlVertex2f(left, top + glyph.dest.height);
+            rlTexCoord2f(u1, v1); rlVertex2f(left + glyph.dest.width, top + glyph.dest.height);
+            rlTexCoord2f(u1, v0); rlVertex2f(left + glyph.dest.width, top);
+        }
+        rlEnd();
+        rlSetTexture(0);
+        profiler.CountDraws(1);
+    }
+
+private:
+    std::unordered_map<std::string, Run> runs;
+    std::string key;
+    unsigned long long useCounter = 0;
+
+    // Mirrors DrawTextEx's placement, one line only.
+    static void BuildRun(Run& run, Font font, const char* text, float fontSize, float spacing) {
+        run.font = font;
+        run.height = (int)fontSize;
+        run.width = (int)MeasureTextEx(font, text, fontSize, spacing).x;
+        run.glyphs.clear();
+
+        float scale = fontSize / font.baseSize;
+        float padding = (float)font.glyphPadding;
+        float penX = 0;
+        int length = (int)strlen(text);
+        for (int i = 0; i < length;) {
+            int codepointSize = 0;
+            int codepoint = GetCodepointNext(&text[i], &codepointSize);
+            i += codepointSize;
+            int index = GetGlyphIndex(font, codepoint);
+            Rectangle rec = font.recs[index];
+            GlyphInfo info = font.glyphs[index];
+
+            if (codepoint != ' ' && codepoint != '\t') {
+                Glyph glyph;
+                glyph.source = Rectangle{rec.x - padding, rec.y - padding, rec.width + 2 * padding, rec.height + 2 * padding};
+                glyph.dest = Rectangle{penX + (info.offsetX - padding) * scale, (info.offsetY - padding) * scale,
+                                       (rec.width + 2 * padding) * scale, (rec.height + 2 * padding) * scale};
+                run.glyphs.push_back(glyph);
+            }
+            penX += (info.advanceX == 0 ? rec.width : (float)info.advanceX) * scale + spacing;
+        }
+    }
+
+    void EvictOldest() {
+        auto oldest = runs.begin();
+        for (auto it = runs.begin(); it != runs.end(); ++it) {
+            if (it->second.lastUsed < oldest->second.lastUsed) {
+                oldest = it;
+            }
+        }
+        if (oldest != runs.end()) {
+            runs.erase(oldest);
+        }
+    }
+};
+
+// A HUD string that is only formatted again when the value it shows changes.
+// Each label is meant to show one kind of value, a number or a string.
+struct HudLabel {
+    const char* format = nullptr;
+    int number = 0;
+    const char* string = nullptr;
+    char text[64] = "";
+
+    const char* Format(const char* fmt, int value) {
+        if (fmt != format || value != number) {
+            format = fmt;
+            number = value;
+            snprintf(text, sizeof(text), fmt, value);
+        }
+        return text;
+    }
+
+    const char* Format(const char* fmt, const char* value) {
+        if (fmt != format || value != string) {
+            format = fmt;
+            string = value;
+            snprintf(text, sizeof(text), fmt, value);
+        }
+        return text;
+    }
+};
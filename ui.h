@@ -1,8 +1,27 @@
 #pragma once
 #include "raylib.h"
+#include "rlgl.h"
 #include "globals.h"
+#include "profiler.h"
 #include <functional>
 
+// Width of the last string measured, so widgets whose label does not change
+// call MeasureText once instead of every frame.
+struct MeasuredText {
+    const char* text = nullptr;
+    int fontSize = 0;
+    int width = 0;
+
+    int Width(const char* str, int size) {
+        if (str != text || size != fontSize) {
+            text = str;
+            fontSize = size;
+            width = MeasureText(str, size);
+        }
+        return width;
+    }
+};
+
 struct Button {
     Rectangle bounds;
     const char* text;
@@ -13,6 +32,8 @@ struct Button {
     bool isHovered;
     bool isSelected;
     int fontSize;
+    MeasuredText measured;
+    int drawnState = -1;
 
     Button() {
         bounds = {0, 0, 0, 0};
@@ -60,12 +81,21 @@ struct Button {
             DrawRectangleRoundedLines(bounds, 0.3f, 6, red);
         }
 
-        int textWidth = MeasureText(text, fontSize);
+        int textWidth = measured.Width(text, fontSize);
         float textX = bounds.x + (bounds.width - textWidth) / 2;
         float textY = bounds.y + (bounds.height - fontSize) / 2;
         DrawText(text, (int)textX, (int)textY, fontSize, textColor);
     }
 
+    // Everything Draw depends on, so a LayerCache can tell when to redraw.
+    int VisualState() const {
+        return (isHovered ? 1 : 0) | (isSelected ? 2 : 0);
+    }
+
+    Rectangle DirtyBounds() const {
+        return bounds;
+    }
+
     bool IsClicked() {
         return isHovered && IsMouseButtonPressed(MOUSE_BUTTON_LEFT);
     }
@@ -79,6 +109,7 @@ struct ToggleButton {
     Color inactiveColor;
     bool isHovered;
     int fontSize;
+    int drawnState = -1;
 
     ToggleButton(float x, float y, float width, float height, const char* lbl, bool* val) {
         bounds = {x, y, width, height};
@@ -114,11 +145,19 @@ struct ToggleButton {
         DrawCircle((int)circleX, (int)circleY, circleRadius, WHITE);
         
         const char* stateText = *value ? "ON" : "OFF";
-        int textWidth = MeasureText(stateText, fontSize);
         float textX = bounds.x + bounds.width + 25;
         float textY = bounds.y + (bounds.height - fontSize) / 2;
         DrawText(stateText, (int)textX, (int)textY, fontSize, darkGreen);
     }
+
+    int VisualState() const {
+        return (isHovered ? 1 : 0) | (*value ? 2 : 0);
+    }
+
+    // Includes the ON/OFF label drawn to the right of the switch.
+    Rectangle DirtyBounds() const {
+        return Rectangle{bounds.x, bounds.y, bounds.width + 25 + MeasureText("OFF", fontSize), bounds.height};
+    }
 };
 
 struct SelectorButton {
@@ -130,6 +169,8 @@ struct SelectorButton {
     bool leftHovered;
     bool rightHovered;
     int fontSize;
+    MeasuredText measured;
+    int drawnState = -1;
 
     SelectorButton(float x, float y, float width, float height, const char* lbl,
                   int* idx, int count, const char** opts) {
@@ -173,11 +214,19 @@ struct SelectorButton {
         DrawText(">", (int)(bounds.x + bounds.width - 26), (int)(bounds.y + bounds.height/2 - 10), 22, rightColor);
         
         const char* currentOption = options[*currentIndex];
-        int textWidth = MeasureText(currentOption, fontSize);
+        int textWidth = measured.Width(currentOption, fontSize);
         float textX = bounds.x + (bounds.width - textWidth) / 2;
         float textY = bounds.y + (bounds.height - fontSize) / 2;
         DrawText(currentOption, (int)textX, (int)textY, fontSize, darkGreen);
     }
+
+    int VisualState() const {
+        return (leftHovered ? 1 : 0) | (rightHovered ? 2 : 0) | (*currentIndex << 2);
+    }
+
+    Rectangle DirtyBounds() const {
+        return bounds;
+    }
 };
 
 struct ColorSelector {
@@ -190,6 +239,8 @@ struct ColorSelector {
     bool leftHovered;
     bool rightHovered;
     int fontSize;
+    MeasuredText measured;
+    int drawnState = -1;
 
     ColorSelector(float x, float y, float width, float height, const char* lbl,
                  int* idx, Color* cols, const char** names, int count) {
@@ -238,9 +289,134 @@ struct ColorSelector {
         DrawRectangleRoundedLines(colorPreview, 0.2f, 4, darkGreen);
         
         const char* name = colorNames[*currentIndex];
-        int textWidth = MeasureText(name, fontSize);
+        int textWidth = measured.Width(name, fontSize);
         float textX = bounds.x + (bounds.width - textWidth) / 2 - 15;
         float textY = bounds.y + (bounds.height - fontSize) / 2;
         DrawText(name, (int)textX, (int)textY, fontSize, darkGreen);
     }
+
+    int VisualState() const {
+        return (leftHovered ? 1 : 0) | (rightHovered ? 2 : 0) | (*currentIndex << 2);
+    }
+
+    Rectangle DirtyBounds() const {
+        return bounds;
+    }
+};
+
+// Retained rendering for screens that mostly sit still. The static parts of
+// a screen (background, panels, labels) are drawn once into staticLayer;
+// composite holds the finished screen. Each frame only widgets whose
+// VisualState changed are redrawn into composite, clipped to their bounds
+// over a copy of the static layer, and composite is drawn with one quad.
+// An idle menu therefore costs a single textured draw.
+class LayerCache {
+public:
+    RenderTexture2D staticLayer;
+    RenderTexture2D composite;
+    bool loaded = false;
+    int screen = -1;
+    unsigned long long staticKey = 0;
+    bool recomposite = false;
+    bool compositeOpen = false;
+
+    ~LayerCache() {
+        Unload();
+    }
+
+    void Unload() {
+        if (loaded) {
+            UnloadRenderTexture(staticLayer);
+            UnloadRenderTexture(composite);
+            loaded = false;
+        }
+        screen = -1;
+    }
+
+    // Returns true when the static layer of screenId has to be redrawn
+    // because the screen changed or key (anything the static parts depend
+    // on) did. The caller then draws it and calls EndStatic.
+    bool BeginStatic(int screenId, unsigned long long key) {
+        if (!loaded) {
+            staticLayer = LoadRenderTexture(WINDOW_WIDTH, WINDOW_HEIGHT);
+            composite = LoadRenderTexture(WINDOW_WIDTH, WINDOW_HEIGHT);
+            loaded = true;
+        }
+        if (screenId == screen && key == staticKey) {
+            return false;
+        }
+        screen = screenId;
+        staticKey = key;
+        BeginTextureMode(staticLayer);
+        return true;
+    }
+
+    void EndStatic() {
+        EndTextureMode();
+        recomposite = true;
+    }
+
+    // Forces the next frame to rebuild the static layer, for example after
+    // something outside the key changed.
+    void Invalidate() {
+        screen = -1;
+    }
+
+    template <typename Widget>
+    void DrawWidget(Widget& widget) {
+        int state = widget.VisualState();
+        if (!recomposite && state == widget.drawnState) {
+            return;
+        }
+        widget.drawnState = state;
+        OpenComposite();
+        if (!recomposite) {
+            // Rounded outlines spill a pixel or two past the bounds.
+            Rectangle area = widget.DirtyBounds();
+            BeginScissorMode((int)area.x - 2, (int)area.y - 2, (int)area.width + 4, (int)area.height + 4);
+            DrawLayer(staticLayer);
+        }
+        widget.Draw();
+        if (!recomposite) {
+            EndScissorMode();
+        }
+    }
+
+    void Present() {
+        if (recomposite) {
+            OpenComposite();
+        }
+        if (compositeOpen) {
+            EndTextureMode();
+            compositeOpen = false;
+        }
+        recomposite = false;
+        DrawLayer(composite);
+    }
+
+private:
+    void OpenComposite() {
+        if (compositeOpen) {
+            return;
+        }
+        BeginTextureMode(composite);
+        compositeOpen = true;
+        if (recomposite) {
+            DrawLayer(staticLayer);
+        }
+    }
+
+    // Render textures are stored upside down, hence the negative height.
+    // Layers are copied as they are, blending off: translucent panels leave
+    // their alpha below 1 in the layer, and alpha blending the layer would
+    // let whatever was underneath (the last frame's board, say) show
+    // through.
+    static void DrawLayer(const RenderTexture2D& layer) {
+        rlSetBlendFactors(RL_ONE, RL_ZERO, RL_FUNC_ADD);
+        BeginBlendMode(BLEND_CUSTOM);
+        DrawTextureRec(layer.texture, Rectangle{0, 0, (float)layer.texture.width, -(float)layer.texture.height},
+                       Vector2{0, 0}, WHITE);
+        EndBlendMode();
+        profiler.CountDraws(1);
+    }
 };
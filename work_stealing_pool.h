@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a loop body over [0, count) on a fixed set of threads. Each worker
+// starts with an equal slice and splits it as it goes, keeping the unsplit
+// remainder on its own deque. A worker that runs dry steals the oldest
+// (largest) range from someone else, so uneven item costs balance out.
+// The only shared counter is touched once per grain, not once per item.
+class WorkStealingPool {
+public:
+    struct Range {
+        long long begin;
+        long long end;
+    };
+
+    int threadCount;
+
+    explicit WorkStealingPool(int threads) {
+        threadCount = threads > 0 ? threads : 1;
+    }
+
+    // body(worker, index) is called exactly once per index. worker is in
+    // [0, threadCount), so callers can keep per-worker state without locks.
+    template <typename Body>
+    void ParallelFor(long long count, long long grain, Body body) {
+        if (grain < 1) grain = 1;
+        std::vector<WorkerQueue> queues(threadCount);
+        for (int w = 0; w < threadCount; w++) {
+            long long begin = count * w / threadCount;
+            long long end = count * (w + 1) / threadCount;
+            if (begin < end) {
+                queues[w].ranges.push_back(Range{begin, end});
+            }
+        }
+
+        std::atomic<long long> remaining(count);
+
+        std::vector<std::thread> threads;
+        for (int w = 1; w < threadCount; w++) {
+            threads.emplace_back([&, w]() { WorkerLoop(queues, remaining, w, grain, body); });
+        }
+        WorkerLoop(queues, remaining, 0, grain, body);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    struct alignas(64) WorkerQueue {
+        std::mutex lock;
+        std::deque<Range> ranges;
+    };
+
+    template <typename Body>
+    void WorkerLoop(std::vector<WorkerQueue>& queues, std::atomic<long long>& remaining,
+                    int worker, long long grain, Body& body) {
+        Range range;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (!TakeLocal(queues[worker], range) && !Steal(queues, worker, range)) {
+                // Others may still be holding ranges they have yet to split.
+                std::this_thread::yield();
+                continue;
+            }
+            // Keep a grain-sized piece and hand the rest back to our own
+            // deque, where it stays available to thieves.
+            while (range.end - range.begin > grain) {
+                long long middle = range.begin + (range.end - range.begin) / 2;
+                {
+                    std::lock_guard<std::mutex> guard(queues[worker].lock);
+                    queues[worker].ranges.push_back(Range{middle, range.end});
+                }
+                range.end = middle;
+            }
+            for (long long i = range.begin; i < range.end; i++) {
+                body(worker, i);
+            }
+            remaining.fetch_sub(range.end - range.begin, std::memory_order_acq_rel);
+        }
+    }
+
+    bool TakeLocal(WorkerQueue& queue, Range& range) {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.ranges.empty()) {
+            return false;
+        }
+        range = queue.ranges.back();
+        queue.ranges.pop_back();
+        return true;
+    }
+
+    bool Steal(std::vector<WorkerQueue>& queues, int worker, Range& range) {
+        for (int i = 1; i < threadCount; i++) {
+            WorkerQueue& victim = queues[(worker + i) % threadCount];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.ranges.empty()) {
+                range = victim.ranges.front();
+                victim.ranges.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};